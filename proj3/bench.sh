@@ -0,0 +1,138 @@
+#!/bin/sh
+# Benchmarks life.c on random matrices over a range of process counts and
+# prints the results as JSON, so the runs of two builds can be diffed.
+#
+# usage: bench.sh [-b binary] [-n "1 2 4 8"] [-s ROWSxCOLS] [-d density]
+#                 [-g generations] [-t trials] [-m strong|weak|both]
+#                 [-- life options]
+#
+# Strong scaling steps the same ROWSxCOLS matrix with every process count.
+# Weak scaling gives every process ROWS rows, so the matrix grows with them.
+# Set MPIEXEC to change how processes are started, like
+# MPIEXEC="mpiexec -f hosts".
+
+BIN=./a.out
+PROCS="1 2 4"
+SIZE=2048x2048
+DENSITY=0.5
+GENERATIONS=100
+TRIALS=3
+MODE=both
+MPIEXEC=${MPIEXEC:-mpiexec}
+
+while getopts b:n:s:d:g:t:m: opt; do
+    case $opt in
+        b) BIN=$OPTARG ;;
+        n) PROCS=$OPTARG ;;
+        s) SIZE=$OPTARG ;;
+        d) DENSITY=$OPTARG ;;
+        g) GENERATIONS=$OPTARG ;;
+        t) TRIALS=$OPTARG ;;
+        m) MODE=$OPTARG ;;
+        *) sed -n '4,7s/^# \{0,1\}//p' "$0" >&2; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+OPTIONS="$*"
+
+ROWS=${SIZE%x*}
+COLS=${SIZE#*x}
+
+
+# Runs every trial of one process count and prints a line of
+# processes rows cols then the seconds stepping of each trial, then the
+# seconds per generation spent exchanging and stepping in the last one
+trials() {
+    p=$1
+    rows=$2
+    line="$p $rows $COLS"
+
+    for trial in $(seq "$TRIALS"); do
+        csv=$($MPIEXEC -n "$p" "$BIN" --generate "${rows}x$COLS" \
+              --density "$DENSITY" $OPTIONS "$GENERATIONS" 0 2>&1 >/dev/null \
+              | tail -n 1)
+
+        # The timing line is processes,rows,cols,printMod,iterations, then
+        # seconds at the end of reading, stepping and everything
+        case $csv in
+            "$p,$rows,$COLS,"*) ;;
+            *) echo "bench.sh: run on $p processes failed: $csv" >&2
+               exit 1 ;;
+        esac
+
+        line="$line $(echo "$csv" | awk -F, '{ print $7 - $6 }')"
+        phases=$(echo "$csv" | awk -F, '{ print $10, $11 }')
+    done
+
+    echo "$line $phases"
+}
+
+
+# Turns the lines from trials() into a JSON array. Efficiency compares the
+# work each process got done with the first process count.
+sweep() {
+    weak=$1
+
+    results=$(for p in $PROCS; do
+                  if [ "$weak" = 1 ]; then
+                      trials "$p" $((ROWS * p)) || exit 1
+                  else
+                      trials "$p" "$ROWS" || exit 1
+                  fi
+              done) || exit 1
+
+    echo "$results" | awk -v weak="$weak" -v gens="$GENERATIONS" -v trials="$TRIALS" '
+        {
+            p = $1; rows = $2; cols = $3
+            sum = 0; min = $4; max = $4
+            for (i = 4; i < 4 + trials; ++i) {
+                sum += $i
+                if ($i < min) min = $i
+                if ($i > max) max = $i
+            }
+            mean = sum / trials
+
+            sq = 0
+            for (i = 4; i < 4 + trials; ++i) {
+                sq += ($i - mean) ^ 2
+            }
+            sd = trials > 1 ? sqrt(sq / (trials - 1)) : 0
+
+            if (NR == 1) {
+                baseP = p; baseMean = mean
+            }
+            eff = weak ? baseMean / mean : baseP * baseMean / (p * mean)
+
+            printf "%s    {\"processes\": %d, \"rows\": %d, \"cols\": %d,\n",
+                   (NR > 1 ? ",\n" : ""), p, rows, cols
+            printf "     \"seconds\": {\"mean\": %.6f, \"stddev\": %.6f, " \
+                   "\"min\": %.6f, \"max\": %.6f},\n", mean, sd, min, max
+            printf "     \"exchangeSeconds\": %.9f, \"stepSeconds\": %.9f,\n",
+                   $(4 + trials), $(5 + trials)
+            printf "     \"cellUpdatesPerSecond\": %.0f, " \
+                   "\"efficiency\": %.4f}", rows * cols * gens / mean, eff
+        }
+        END { printf "\n" }'
+}
+
+
+echo "{"
+echo "  \"binary\": \"$BIN\","
+echo "  \"options\": \"$OPTIONS\","
+echo "  \"density\": $DENSITY,"
+echo "  \"generations\": $GENERATIONS,"
+echo "  \"trials\": $TRIALS,"
+
+if [ "$MODE" != weak ]; then
+    echo "  \"strong\": ["
+    sweep 0 || exit 1
+    [ "$MODE" = both ] && echo "  ]," || echo "  ]"
+fi
+
+if [ "$MODE" != strong ]; then
+    echo "  \"weak\": ["
+    sweep 1 || exit 1
+    echo "  ]"
+fi
+
+echo "}"
@@ -0,0 +1,924 @@
+// Bit-packed Game of Life board
+//******************************************************************************
+// bitboard.c
+//
+// Summary: Word-at-a-time Game of Life stepping. Every bit of a word is one
+//          cell, so the eight neighbor counts of 64 cells are added together
+//          with a handful of AND/XOR adders.
+//
+// Author:  agent
+// Created: Oct 2026
+//******************************************************************************
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitboard.h"
+
+// Build with -DBITBOARD_SCALAR to force the portable kernel everywhere
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(BITBOARD_SCALAR)
+#define STEP_SIMD
+#include <immintrin.h>
+#endif
+
+// Fewest words in a region before stepRegion() splits it between threads
+#define PARALLEL_WORDS 4096
+
+// Tracking tiles stops once this fraction of them has been active for
+// BUSY_GENERATIONS in a row, and starts again RETRY_GENERATIONS later
+#define BUSY_FRACTION     0.75
+#define BUSY_GENERATIONS  4
+#define RETRY_GENERATIONS 64
+
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+
+
+uint64_t** allocBoard(int numRows, int rowWords) {
+    uint64_t*  storage; // Bulk storage for every row
+    uint64_t** board;   // 2D version of the above
+    int r;
+
+    storage = (uint64_t*)  calloc((size_t) numRows * rowWords, sizeof(uint64_t));
+    board   = (uint64_t**) malloc(numRows * sizeof(uint64_t*));
+
+    if (storage == NULL || board == NULL) {
+        free(storage);
+        free(board);
+        return NULL;
+    }
+
+    // Link up the rows
+    for (r = 0; r < numRows; ++r) {
+        board[r] = storage + (size_t) r * rowWords;
+    }
+
+    return board;
+}
+
+
+void freeBoard(uint64_t** board) {
+    if (board != NULL) {
+        free(board[0]);
+        free(board);
+    }
+}
+
+
+uint64_t lastWordMask(int numCols) {
+    int used = numCols % CELLS_PER_WORD; // Real cells in the last word
+
+    return used == 0 ? ~(uint64_t) 0 : ((uint64_t) 1 << used) - 1;
+}
+
+
+void packRow(const char* cells, uint64_t* row, int numCols) {
+    int c;
+
+    for (c = 0; c < numCols; ++c) {
+        if (cells[c] == LIVE) {
+            SET_CELL(row, c);
+        }
+    }
+}
+
+
+// Adds each row of neighbors into two bit sums, then sums the ones bits,
+// carrying into the twos. Declares what it sets, so it goes at the start of
+// a block.
+#define ADD_NEIGHBORS(T, AND, OR, XOR, aw, ac, ae, mw, me, bw, bc, be)        \
+    T a0 = XOR(XOR(aw, ac), ae);     /* Two bit sum of the cells above */     \
+    T a1 = OR(AND(aw, ac), AND(ae, XOR(aw, ac)));                              \
+    T b0 = XOR(XOR(bw, bc), be);     /* Two bit sum of the cells below */     \
+    T b1 = OR(AND(bw, bc), AND(be, XOR(bw, bc)));                              \
+    T m0 = XOR(mw, me);              /* Two bit sum of the cells beside */    \
+    T m1 = AND(mw, me);                                                        \
+    T s0 = XOR(XOR(a0, b0), m0);     /* Ones bit of the total */              \
+    T k0 = OR(AND(a0, b0), AND(m0, XOR(a0, b0))) /* and its carry */
+
+// The bit-sliced B3/S23 rule, shared by the scalar and SIMD kernels so they
+// cannot disagree. Every rule is given the counts it is built for, the word
+// type and its and, or, xor and and-not (~a & b) operations, a word of all
+// ones, then the neighbors of the cells lined up with them, and out receives
+// the next generation. This one knows its counts already.
+#define LIFE_RULE(BORN, SURVIVE, T, AND, OR, XOR, ANDN, ONES,                 \
+                  aw, ac, ae, mw, mc, me, bw, bc, be, out)                     \
+    do {                                                                       \
+        ADD_NEIGHBORS(T, AND, OR, XOR, aw, ac, ae, mw, me, bw, bc, be);        \
+                                                                               \
+        /* The count is 2 or 3 when exactly one twos bit is set */            \
+        T twosIsOne = ANDN(OR(AND(a1, b1), AND(m1, k0)),                       \
+                           XOR(XOR(a1, b1), XOR(m1, k0)));                     \
+                                                                               \
+        /* Born with 3 neighbors, survive with 2 or 3 */                      \
+        out = AND(twosIsOne, OR(s0, mc));                                      \
+    } while (0)
+
+// Sets eq[n] to the cells with n neighbors, for the rules that need the
+// whole count. The count is s0 plus twice the number of twos bits set.
+#define COUNT_NEIGHBORS(T, AND, OR, XOR, ANDN, ONES,                          \
+                        aw, ac, ae, mw, me, bw, bc, be, eq)                    \
+    do {                                                                       \
+        ADD_NEIGHBORS(T, AND, OR, XOR, aw, ac, ae, mw, me, bw, bc, be);        \
+        T p0, q0;      /* Ones bits of the twos bits added in pairs */        \
+        T t0, t1, t2;  /* Number of twos bits set, in binary */               \
+        T twos[4];     /* Cells with each number of twos bits below 4 */      \
+                                                                               \
+        p0 = XOR(a1, b1);                                                      \
+        q0 = XOR(m1, k0);                                                      \
+        t0 = XOR(p0, q0);                                                      \
+        t1 = XOR(XOR(AND(a1, b1), AND(m1, k0)), AND(p0, q0));                  \
+        t2 = AND(AND(a1, b1), AND(m1, k0));                                    \
+                                                                               \
+        /* All four are set when t2 is, so it leaves t0 and t1 clear */       \
+        twos[0] = ANDN(OR(OR(t0, t1), t2), ONES);                              \
+        twos[1] = ANDN(OR(t1, t2), t0);                                        \
+        twos[2] = ANDN(t0, t1);                                                \
+        twos[3] = AND(t0, t1);                                                 \
+                                                                               \
+        eq[0] = ANDN(s0, twos[0]);                                             \
+        eq[1] = AND(s0, twos[0]);                                              \
+        eq[2] = ANDN(s0, twos[1]);                                             \
+        eq[3] = AND(s0, twos[1]);                                              \
+        eq[4] = ANDN(s0, twos[2]);                                             \
+        eq[5] = AND(s0, twos[2]);                                              \
+        eq[6] = ANDN(s0, twos[3]);                                             \
+        eq[7] = AND(s0, twos[3]);                                              \
+        eq[8] = t2;                                                            \
+    } while (0)
+
+// Adds the cells with n neighbors that are born or survive to out. BORN and
+// SURVIVE are constants, so this is either one operation or nothing.
+#define RULE_COUNT(BORN, SURVIVE, n, AND, OR, ANDN, mc, eq, out)              \
+    if (((BORN) >> (n) & 1) && ((SURVIVE) >> (n) & 1)) {                       \
+        out = OR(out, eq[n]);                                                  \
+    } else if ((BORN) >> (n) & 1) {                                            \
+        out = OR(out, ANDN(mc, eq[n]));                                        \
+    } else if ((SURVIVE) >> (n) & 1) {                                         \
+        out = OR(out, AND(mc, eq[n]));                                         \
+    }
+
+// Any Life-like rule, with bit n of BORN set if a dead cell with n neighbors
+// comes to life and bit n of SURVIVE if a live one stays alive. Kernels are
+// only made with this for rules known when the program is built, so the
+// counts that are not in the rule drop out.
+#define LIFE_LIKE_RULE(BORN, SURVIVE, T, AND, OR, XOR, ANDN, ONES,            \
+                       aw, ac, ae, mw, mc, me, bw, bc, be, out)                \
+    do {                                                                       \
+        T eq[9];                                                               \
+                                                                               \
+        COUNT_NEIGHBORS(T, AND, OR, XOR, ANDN, ONES,                           \
+                        aw, ac, ae, mw, me, bw, bc, be, eq);                   \
+                                                                               \
+        out = XOR(mc, mc);                                                     \
+        RULE_COUNT(BORN, SURVIVE, 0, AND, OR, ANDN, mc, eq, out)               \
+        RULE_COUNT(BORN, SURVIVE, 1, AND, OR, ANDN, mc, eq, out)               \
+        RULE_COUNT(BORN, SURVIVE, 2, AND, OR, ANDN, mc, eq, out)               \
+        RULE_COUNT(BORN, SURVIVE, 3, AND, OR, ANDN, mc, eq, out)               \
+        RULE_COUNT(BORN, SURVIVE, 4, AND, OR, ANDN, mc, eq, out)               \
+        RULE_COUNT(BORN, SURVIVE, 5, AND, OR, ANDN, mc, eq, out)               \
+        RULE_COUNT(BORN, SURVIVE, 6, AND, OR, ANDN, mc, eq, out)               \
+        RULE_COUNT(BORN, SURVIVE, 7, AND, OR, ANDN, mc, eq, out)               \
+        RULE_COUNT(BORN, SURVIVE, 8, AND, OR, ANDN, mc, eq, out)               \
+    } while (0)
+
+// Adds the cells with n neighbors that the tables say are born or survive
+#define TABLE_COUNT(BORN, SURVIVE, n, AND, OR, ANDN, mc, eq, out)             \
+    out = OR(out, AND(eq[n], OR(ANDN(mc, BORN[n]), AND(mc, SURVIVE[n]))))
+
+// Any rule at all, for the ones without kernels of their own. BORN and
+// SURVIVE are arrays of words that are all ones for the counts in the rule,
+// so every count is looked at but nothing branches.
+#define TABLE_RULE(BORN, SURVIVE, T, AND, OR, XOR, ANDN, ONES,                \
+                   aw, ac, ae, mw, mc, me, bw, bc, be, out)                    \
+    do {                                                                       \
+        T eq[9];                                                               \
+                                                                               \
+        COUNT_NEIGHBORS(T, AND, OR, XOR, ANDN, ONES,                           \
+                        aw, ac, ae, mw, me, bw, bc, be, eq);                   \
+                                                                               \
+        out = XOR(mc, mc);                                                     \
+        TABLE_COUNT(BORN, SURVIVE, 0, AND, OR, ANDN, mc, eq, out);             \
+        TABLE_COUNT(BORN, SURVIVE, 1, AND, OR, ANDN, mc, eq, out);             \
+        TABLE_COUNT(BORN, SURVIVE, 2, AND, OR, ANDN, mc, eq, out);             \
+        TABLE_COUNT(BORN, SURVIVE, 3, AND, OR, ANDN, mc, eq, out);             \
+        TABLE_COUNT(BORN, SURVIVE, 4, AND, OR, ANDN, mc, eq, out);             \
+        TABLE_COUNT(BORN, SURVIVE, 5, AND, OR, ANDN, mc, eq, out);             \
+        TABLE_COUNT(BORN, SURVIVE, 6, AND, OR, ANDN, mc, eq, out);             \
+        TABLE_COUNT(BORN, SURVIVE, 7, AND, OR, ANDN, mc, eq, out);             \
+        TABLE_COUNT(BORN, SURVIVE, 8, AND, OR, ANDN, mc, eq, out);             \
+    } while (0)
+
+
+// Steps words [firstWord, lastWord] of a row, N at a time, and returns the
+// first word left over. Unaligned loads at w-1 and w+1 bring in the
+// neighboring words, so the shifts never cross a register. Kernels made with
+// DIFF set also OR the cells that changed into diff.
+typedef int (*WordStep)(const uint64_t* above, const uint64_t* row,
+                        const uint64_t* below, uint64_t* next,
+                        int firstWord, int lastWord, uint64_t* diff);
+
+// The kernels made for one rule, each without and with a diff
+struct ruleKernels {
+    int born;             // Counts the kernels were made for
+    int survive;
+    WordStep scalar[2];   // One word at a time
+#ifdef STEP_SIMD
+    WordStep sse2[2];     // Two and four words at a time
+    WordStep avx2[2];
+#endif
+};
+typedef struct ruleKernels RuleKernels;
+
+// Counts of the rule being run as words of all ones or all zeros, for the
+// table kernels
+static uint64_t tableBorn[9];
+static uint64_t tableSurvive[9];
+
+#define DEFINE_WORD_STEP(name, ATTR, T, N, DIFF, RULE, BORN, SURVIVE, LOAD,    \
+                         STORE, AND, OR, XOR, ANDN, SHL, SHR, FILL)            \
+ATTR                                                                           \
+static int name(const uint64_t* above, const uint64_t* row,                   \
+                const uint64_t* below, uint64_t* next,                         \
+                int firstWord, int lastWord, uint64_t* diff) {                 \
+    T aw, ac, ae, mw, mc, me, bw, bc, be, out;                                 \
+    T ones = FILL(~(uint64_t) 0);                                              \
+    T born[9], survive[9];                                                     \
+    int n;                                                                     \
+    int w;                                                                     \
+                                                                               \
+    /* Only the table kernels look at these */                                \
+    for (n = 0; n < 9; ++n) {                                                  \
+        born[n]    = FILL(tableBorn[n]);                                       \
+        survive[n] = FILL(tableSurvive[n]);                                    \
+    }                                                                          \
+                                                                               \
+    for (w = firstWord; w + (N) - 1 <= lastWord; w += (N)) {                   \
+        ac = LOAD(above + w);                                                  \
+        aw = OR(SHL(ac, 1), SHR(LOAD(above + w - 1), 63));                     \
+        ae = OR(SHR(ac, 1), SHL(LOAD(above + w + 1), 63));                     \
+                                                                               \
+        mc = LOAD(row + w);                                                    \
+        mw = OR(SHL(mc, 1), SHR(LOAD(row + w - 1), 63));                       \
+        me = OR(SHR(mc, 1), SHL(LOAD(row + w + 1), 63));                       \
+                                                                               \
+        bc = LOAD(below + w);                                                  \
+        bw = OR(SHL(bc, 1), SHR(LOAD(below + w - 1), 63));                     \
+        be = OR(SHR(bc, 1), SHL(LOAD(below + w + 1), 63));                     \
+                                                                               \
+        RULE(BORN, SURVIVE, T, AND, OR, XOR, ANDN, ones,                       \
+             aw, ac, ae, mw, mc, me, bw, bc, be, out);                         \
+        STORE(next + w, out);                                                  \
+                                                                               \
+        if (DIFF) {                                                            \
+            STORE(diff + w, OR(LOAD(diff + w), XOR(out, mc)));                 \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    (void) ones;                                                               \
+    (void) born;                                                               \
+    (void) survive;                                                            \
+    return w;                                                                  \
+}
+
+#define S_LOAD(p)    (*(p))
+#define S_STORE(p,v) (*(p) = (v))
+#define S_AND(a,b)   ((a) & (b))
+#define S_OR(a,b)    ((a) | (b))
+#define S_XOR(a,b)   ((a) ^ (b))
+#define S_ANDN(a,b)  (~(a) & (b))
+#define S_SHL(a,n)   ((a) << (n))
+#define S_SHR(a,n)   ((a) >> (n))
+#define S_FILL(x)    (x)
+
+#define DEFINE_SCALAR_STEP(name, DIFF, RULE, BORN, SURVIVE)                    \
+    DEFINE_WORD_STEP(name, , uint64_t, 1, DIFF, RULE, BORN, SURVIVE, S_LOAD,   \
+                     S_STORE, S_AND, S_OR, S_XOR, S_ANDN, S_SHL, S_SHR,        \
+                     S_FILL)
+
+
+#ifdef STEP_SIMD
+
+#define AVX_LOAD(p)    _mm256_loadu_si256((const __m256i*) (p))
+#define AVX_STORE(p,v) _mm256_storeu_si256((__m256i*) (p), (v))
+#define AVX_FILL(x)    _mm256_set1_epi64x((long long) (x))
+#define SSE_LOAD(p)    _mm_loadu_si128((const __m128i*) (p))
+#define SSE_STORE(p,v) _mm_storeu_si128((__m128i*) (p), (v))
+#define SSE_FILL(x)    _mm_set1_epi64x((long long) (x))
+
+#define DEFINE_AVX2_STEP(name, DIFF, RULE, BORN, SURVIVE)                      \
+    DEFINE_WORD_STEP(name, __attribute__((target("avx2"))), __m256i, 4, DIFF,  \
+                     RULE, BORN, SURVIVE, AVX_LOAD, AVX_STORE,                 \
+                     _mm256_and_si256, _mm256_or_si256, _mm256_xor_si256,      \
+                     _mm256_andnot_si256, _mm256_slli_epi64,                   \
+                     _mm256_srli_epi64, AVX_FILL)
+
+#define DEFINE_SSE2_STEP(name, DIFF, RULE, BORN, SURVIVE)                      \
+    DEFINE_WORD_STEP(name, __attribute__((target("sse2"))), __m128i, 2, DIFF,  \
+                     RULE, BORN, SURVIVE, SSE_LOAD, SSE_STORE,                 \
+                     _mm_and_si128, _mm_or_si128, _mm_xor_si128,               \
+                     _mm_andnot_si128, _mm_slli_epi64, _mm_srli_epi64,         \
+                     SSE_FILL)
+
+// Makes the scalar and SIMD kernels of a rule
+#define DEFINE_RULE_KERNELS(name, RULE, BORN, SURVIVE)                         \
+    DEFINE_SCALAR_STEP(name##Step,     0, RULE, BORN, SURVIVE)                 \
+    DEFINE_SCALAR_STEP(name##Diff,     1, RULE, BORN, SURVIVE)                 \
+    DEFINE_SSE2_STEP(name##StepSSE2,   0, RULE, BORN, SURVIVE)                 \
+    DEFINE_SSE2_STEP(name##DiffSSE2,   1, RULE, BORN, SURVIVE)                 \
+    DEFINE_AVX2_STEP(name##StepAVX2,   0, RULE, BORN, SURVIVE)                 \
+    DEFINE_AVX2_STEP(name##DiffAVX2,   1, RULE, BORN, SURVIVE)
+
+#define RULE_KERNELS(name)                                                     \
+    {name##Step, name##Diff}, {name##StepSSE2, name##DiffSSE2},                \
+    {name##StepAVX2, name##DiffAVX2}
+
+#else
+
+#define DEFINE_RULE_KERNELS(name, RULE, BORN, SURVIVE)                         \
+    DEFINE_SCALAR_STEP(name##Step, 0, RULE, BORN, SURVIVE)                     \
+    DEFINE_SCALAR_STEP(name##Diff, 1, RULE, BORN, SURVIVE)
+
+#define RULE_KERNELS(name) {name##Step, name##Diff}
+
+#endif
+
+
+// Rules common enough to get kernels of their own
+DEFINE_RULE_KERNELS(life,        LIFE_RULE,      0x008, 0x00c)
+DEFINE_RULE_KERNELS(highLife,    LIFE_LIKE_RULE, 0x048, 0x00c)
+DEFINE_RULE_KERNELS(dayAndNight, LIFE_LIKE_RULE, 0x1c8, 0x1d8)
+DEFINE_RULE_KERNELS(seeds,       LIFE_LIKE_RULE, 0x004, 0x000)
+
+// And the kernels for every other rule
+DEFINE_RULE_KERNELS(table,       TABLE_RULE,     born,  survive)
+
+static const RuleKernels ruleKernels[] = {
+    {0x008, 0x00c, RULE_KERNELS(life)},         // B3/S23
+    {0x048, 0x00c, RULE_KERNELS(highLife)},     // B36/S23
+    {0x1c8, 0x1d8, RULE_KERNELS(dayAndNight)},  // B3678/S34678
+    {0x004, 0x000, RULE_KERNELS(seeds)}         // B2/S
+};
+
+static const RuleKernels tableKernels = {-1, -1, RULE_KERNELS(table)};
+
+// Kernels for the rule being run
+static const RuleKernels* kernels = &ruleKernels[0];
+
+// The rule being run, for building the lookup table
+static LifeRule currentRule = {0x008, 0x00c};
+
+// Step with the lookup table instead of the bit-sliced kernels
+static int useLookup = 0;
+
+// How tiles are tracked, one of TILES_*
+static int tileMode = TILES_AUTO;
+
+// The next generation of the middle 2x2 cells of every 4x4 neighborhood.
+// Bits 4i to 4i+3 of the index are row i of the neighborhood, west to
+// east, and bits 2i and 2i+1 of an entry are middle row i.
+static unsigned char lookupTable[1 << 16];
+
+
+#ifdef STEP_SIMD
+
+// The kernels this CPU can run, picked the first time they are asked for
+static WordStep stepWordsVector[2] = {NULL, NULL};
+
+
+// Picks the widest kernel this CPU supports. Our hosts are not all the same
+// model, so this is decided when the program runs rather than when it builds.
+static WordStep chooseVectorStep(int withDiff) {
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        return kernels->avx2[withDiff];
+    }
+    return kernels->sse2[withDiff];
+}
+
+
+// The vector kernel of the rule for this CPU
+static WordStep vectorStep(int withDiff) {
+    if (stepWordsVector[withDiff] == NULL) {
+        stepWordsVector[withDiff] = chooseVectorStep(withDiff);
+    }
+    return stepWordsVector[withDiff];
+}
+
+#endif
+
+
+static void buildLookupTable(void);
+
+
+int parseRule(const char* text, LifeRule* rule) {
+    int* counts;  // Where the digits being read go, born then survive
+
+    rule->born    = 0;
+    rule->survive = 0;
+
+    if (toupper((unsigned char) *text) != 'B') {
+        return -1;
+    }
+
+    counts = &rule->born;
+
+    for (++text; *text != '\0'; ++text) {
+        if (*text >= '0' && *text <= '8') {
+            *counts |= 1 << (*text - '0');
+        } else if (*text == '/' && counts == &rule->born
+                   && toupper((unsigned char) text[1]) == 'S') {
+            counts = &rule->survive;
+            ++text;
+        } else {
+            return -1;
+        }
+    }
+
+    return counts == &rule->survive ? 0 : -1;
+}
+
+
+void setRule(const LifeRule* rule) {
+    size_t i;
+    int n;
+
+    kernels = &tableKernels;
+
+    for (i = 0; i < sizeof(ruleKernels) / sizeof(RuleKernels); ++i) {
+        if (ruleKernels[i].born == rule->born
+            && ruleKernels[i].survive == rule->survive) {
+            kernels = &ruleKernels[i];
+        }
+    }
+
+    for (n = 0; n < 9; ++n) {
+        tableBorn[n]    = (rule->born    >> n & 1) ? ~(uint64_t) 0 : 0;
+        tableSurvive[n] = (rule->survive >> n & 1) ? ~(uint64_t) 0 : 0;
+    }
+
+#ifdef STEP_SIMD
+    stepWordsVector[0] = NULL;
+    stepWordsVector[1] = NULL;
+#endif
+
+    currentRule = *rule;
+    if (useLookup) {
+        buildLookupTable();
+    }
+}
+
+
+void setKernel(int kernel) {
+    useLookup = kernel == KERNEL_LOOKUP;
+    if (useLookup) {
+        buildLookupTable();
+    }
+}
+
+
+// Fills in the lookup table for the rule being run
+static void buildLookupTable(void) {
+    int index;
+    int r, c;     // Middle cell being worked out
+    int dr, dc;
+    int count;    // Live neighbors it has
+    int alive;
+    unsigned char middle;
+
+    for (index = 0; index < (1 << 16); ++index) {
+        middle = 0;
+
+        for (r = 1; r <= 2; ++r) {
+            for (c = 1; c <= 2; ++c) {
+                count = 0;
+                for (dr = -1; dr <= 1; ++dr) {
+                    for (dc = -1; dc <= 1; ++dc) {
+                        if (dr != 0 || dc != 0) {
+                            count += index >> (4 * (r + dr) + c + dc) & 1;
+                        }
+                    }
+                }
+
+                alive = index >> (4 * r + c) & 1;
+                if ((alive ? currentRule.survive : currentRule.born)
+                    >> count & 1) {
+                    middle |= 1 << (2 * (r - 1) + c - 1);
+                }
+            }
+        }
+
+        lookupTable[index] = middle;
+    }
+}
+
+
+// Steps words [firstWord, lastWord] of two rows, row0 and row1, two columns
+// at a time with one lookup for each 2x2 block of cells. When below is NULL
+// only row0 is stepped, with dead cells under row1. Changes are ORed into
+// diff when it is not NULL.
+static void stepLookup(const uint64_t* above, const uint64_t* row0,
+                       const uint64_t* row1, const uint64_t* below,
+                       uint64_t* next0, uint64_t* next1, int firstWord,
+                       int lastWord, uint64_t* diff) {
+
+    const uint64_t* rows[4];  // The four rows of the neighborhoods
+    uint64_t lo[4];           // Each row moved up a bit, so bits 2j to 2j+3
+    uint64_t hi[4];           // are the columns around cells 2j and 2j+1,
+                              // with the two bits past the word in hi
+    uint64_t out[2];          // Next generation of both rows of the word
+    unsigned char middle;
+    int index;
+    int i;
+    int j;
+    int w;
+
+    rows[0] = above;
+    rows[1] = row0;
+    rows[2] = row1;
+    rows[3] = below;
+
+    for (w = firstWord; w <= lastWord; ++w) {
+        for (i = 0; i < 4; ++i) {
+            if (rows[i] == NULL) {
+                lo[i] = 0;
+                hi[i] = 0;
+            } else {
+                lo[i] = (rows[i][w] << 1) | (rows[i][w-1] >> 63);
+                hi[i] = (rows[i][w] >> 63) | ((rows[i][w+1] & 1) << 1);
+            }
+        }
+
+        out[0] = 0;
+        out[1] = 0;
+
+        for (j = 0; j < CELLS_PER_WORD / 2; ++j) {
+            if (j < CELLS_PER_WORD / 2 - 1) {
+                index = (int) ((lo[0] >> 2*j & 0xf)
+                               | (lo[1] >> 2*j & 0xf) << 4
+                               | (lo[2] >> 2*j & 0xf) << 8
+                               | (lo[3] >> 2*j & 0xf) << 12);
+            } else {
+                index = (int) ((lo[0] >> 62 | hi[0] << 2)
+                               | (lo[1] >> 62 | hi[1] << 2) << 4
+                               | (lo[2] >> 62 | hi[2] << 2) << 8
+                               | (lo[3] >> 62 | hi[3] << 2) << 12);
+            }
+
+            middle  = lookupTable[index];
+            out[0] |= (uint64_t) (middle & 3) << 2*j;
+            out[1] |= (uint64_t) (middle >> 2) << 2*j;
+        }
+
+        next0[w] = out[0];
+        if (diff != NULL) {
+            diff[w] |= out[0] ^ row0[w];
+        }
+
+        if (below != NULL) {
+            next1[w] = out[1];
+            if (diff != NULL) {
+                diff[w] |= out[1] ^ row1[w];
+            }
+        }
+    }
+}
+
+
+// Steps words [firstWord, lastWord] of a row, and when diff is not NULL
+// ORs the cells that changed into it
+static inline void stepWords(const uint64_t* above, const uint64_t* row,
+                             const uint64_t* below, uint64_t* next,
+                             int firstWord, int lastWord, uint64_t* diff) {
+
+    int withDiff = diff != NULL;
+    int w = firstWord;
+
+#ifdef STEP_SIMD
+    w = vectorStep(withDiff)(above, row, below, next, firstWord, lastWord,
+                             diff);
+#endif
+
+    // Finish the words that did not fill a whole vector
+    if (w <= lastWord) {
+        kernels->scalar[withDiff](above, row, below, next, w, lastWord, diff);
+    }
+}
+
+
+void stepRow(const uint64_t* above, const uint64_t* row, const uint64_t* below,
+             uint64_t* next, int firstWord, int lastWord) {
+
+    stepWords(above, row, below, next, firstWord, lastWord, NULL);
+}
+
+
+// Steps rows [firstRow, lastRow] of words [firstWord, lastWord] with the
+// kernel that was picked, ORing the changes into diff if it is not NULL
+static void stepRows(uint64_t** board, uint64_t** next, int firstRow,
+                     int lastRow, int firstWord, int lastWord,
+                     uint64_t* diff) {
+    int r;
+
+    if (!useLookup) {
+        for (r = firstRow; r <= lastRow; ++r) {
+            stepWords(board[r-1], board[r], board[r+1], next[r], firstWord,
+                      lastWord, diff);
+        }
+        return;
+    }
+
+    // The table steps rows in pairs, and an odd one out on its own
+    for (r = firstRow; r + 1 <= lastRow; r += 2) {
+        stepLookup(board[r-1], board[r], board[r+1], board[r+2], next[r],
+                   next[r+1], firstWord, lastWord, diff);
+    }
+    if (r == lastRow) {
+        stepLookup(board[r-1], board[r], board[r+1], NULL, next[r], NULL,
+                   firstWord, lastWord, diff);
+    }
+}
+
+
+void stepRegion(uint64_t** board, uint64_t** next, int firstRow, int lastRow,
+                int firstWord, int lastWord, int maskWord, uint64_t lastMask) {
+    int rowsAtOnce = useLookup ? 2 : 1;  // Rows a kernel call steps
+    int r;
+    int i;
+
+#ifdef STEP_SIMD
+    // Pick the kernel before the threads start so they don't race to
+    vectorStep(0);
+#endif
+
+    // Rows are independent, so a thread team can split them. Thin edges
+    // are not worth waking the team for.
+    #pragma omp parallel for schedule(static) private(i) \
+            if ((long) (lastRow - firstRow + 1) * (lastWord - firstWord + 1) \
+                >= PARALLEL_WORDS)
+    for (r = firstRow; r <= lastRow; r += rowsAtOnce) {
+        stepRows(board, next, r, MIN(r + rowsAtOnce - 1, lastRow), firstWord,
+                 lastWord, NULL);
+
+        // Keep births out of the unused bits past the last column
+        if (firstWord <= maskWord && maskWord <= lastWord) {
+            for (i = r; i <= MIN(r + rowsAtOnce - 1, lastRow); ++i) {
+                next[i][maskWord] &= lastMask;
+            }
+        }
+    }
+}
+
+
+void setTiles(int mode) {
+    tileMode = mode;
+}
+
+
+int createTiles(TileMap* tiles, int firstRow, int numRows, int firstWord,
+                int numWords) {
+
+    size_t numTiles;
+
+    tiles->firstRow  = firstRow;
+    tiles->firstWord = firstWord;
+    tiles->numRows   = numRows;
+    tiles->numWords  = numWords;
+    tiles->tileRows  = (numRows + TILE_ROWS - 1) / TILE_ROWS;
+    tiles->tileCols  = (numWords + TILE_WORDS - 1) / TILE_WORDS;
+
+    numTiles = (size_t) tiles->tileRows * tiles->tileCols;
+
+    // Nothing is known about the first generation, so step all of it
+    tiles->changed = (unsigned char*) malloc(numTiles);
+    tiles->active  = (unsigned char*) calloc(numTiles, 1);
+    tiles->diff    = (uint64_t*) malloc((size_t) tiles->tileRows
+                                        * (firstWord + numWords)
+                                        * sizeof(uint64_t));
+
+    if (tiles->changed == NULL || tiles->active == NULL
+        || tiles->diff == NULL) {
+        freeTiles(tiles);
+        return -1;
+    }
+
+    memset(tiles->changed, 1, numTiles);
+
+    tiles->tracking  = tileMode != TILES_OFF;
+    tiles->busy      = 0;
+    tiles->untracked = 0;
+    if (!tiles->tracking) {
+        memset(tiles->active, 1, numTiles);
+    }
+    return 0;
+}
+
+
+void freeTiles(TileMap* tiles) {
+    free(tiles->changed);
+    free(tiles->active);
+    free(tiles->diff);
+    tiles->changed = NULL;
+    tiles->active  = NULL;
+    tiles->diff    = NULL;
+}
+
+
+void activateTiles(TileMap* tiles) {
+    size_t numTiles;      // Tiles in the map
+    size_t numActive;     // Tiles that have to be stepped
+    int tr;
+    int tc;
+    int r;
+    int c;
+    unsigned char near;   // Some tile around this one changed
+
+    numTiles = (size_t) tiles->tileRows * tiles->tileCols;
+
+    // Every tile is still active, so only the changes have to start over
+    // when it is time to look again
+    if (!tiles->tracking) {
+        if (tileMode == TILES_AUTO && --tiles->untracked <= 0) {
+            memset(tiles->changed, 0, numTiles);
+            tiles->tracking = 1;
+            tiles->busy     = BUSY_GENERATIONS - 1;
+        }
+        return;
+    }
+
+    numActive = 0;
+    for (tr = 0; tr < tiles->tileRows; ++tr) {
+        for (tc = 0; tc < tiles->tileCols; ++tc) {
+            near = 0;
+
+            for (r = tr - 1; r <= tr + 1; ++r) {
+                for (c = tc - 1; c <= tc + 1; ++c) {
+                    if (r >= 0 && r < tiles->tileRows
+                        && c >= 0 && c < tiles->tileCols) {
+                        near |= tiles->changed[r * tiles->tileCols + c];
+                    }
+                }
+            }
+
+            tiles->active[tr * tiles->tileCols + tc] = near;
+            numActive += near;
+        }
+    }
+
+    memset(tiles->changed, 0, numTiles);
+
+    if (tileMode != TILES_AUTO) {
+        return;
+    }
+
+    // A board this busy is stepped faster without looking for changes
+    tiles->busy = numActive >= BUSY_FRACTION * numTiles ? tiles->busy + 1 : 0;
+    if (tiles->busy >= BUSY_GENERATIONS) {
+        memset(tiles->active, 1, numTiles);
+        memset(tiles->changed, 1, numTiles);
+        tiles->tracking  = 0;
+        tiles->untracked = RETRY_GENERATIONS;
+    }
+}
+
+
+// Finds the range of tiles down or across that overlap [first, last]
+static void tileRange(int first, int last, int start, int size, int count,
+                      int range[2]) {
+
+    range[0] = first < start ? 0 : (first - start) / size;
+    range[1] = last < start ? -1 : (last - start) / size;
+
+    if (range[1] >= count) {
+        range[1] = count - 1;
+    }
+}
+
+
+void touchTiles(TileMap* tiles, int firstRow, int lastRow, int firstWord,
+                int lastWord) {
+
+    int rows[2];  // Tiles that overlap the area
+    int cols[2];
+    int tr;
+    int tc;
+
+    tileRange(firstRow, lastRow, tiles->firstRow, TILE_ROWS,
+              tiles->tileRows, rows);
+    tileRange(firstWord, lastWord, tiles->firstWord, TILE_WORDS,
+              tiles->tileCols, cols);
+
+    for (tr = rows[0]; tr <= rows[1]; ++tr) {
+        for (tc = cols[0]; tc <= cols[1]; ++tc) {
+            tiles->active[tr * tiles->tileCols + tc] = 1;
+        }
+    }
+}
+
+
+void stepTiles(uint64_t** board, uint64_t** next, TileMap* tiles,
+               int firstRow, int lastRow, int firstWord, int lastWord,
+               int maskWord, uint64_t lastMask) {
+
+    int rows[2];  // Tiles that overlap the region
+    int cols[2];
+    int tr;
+    int tc;
+    int run;      // Last tile in a run of active tiles
+    int r;
+    int r0, r1;   // Part of the region in a run of tiles
+    int w0, w1;
+    int w;
+    uint64_t* diff;          // Changes to each word in this row of tiles
+    unsigned char* active;   // Flags for this row of tiles
+    unsigned char* changed;
+
+    if (firstRow > lastRow || firstWord > lastWord) {
+        return;
+    }
+
+    // Every tile changes as far as anyone can tell
+    if (!tiles->tracking) {
+        stepRegion(board, next, firstRow, lastRow, firstWord, lastWord,
+                   maskWord, lastMask);
+        return;
+    }
+
+#ifdef STEP_SIMD
+    vectorStep(1);
+#endif
+
+    tileRange(firstRow, lastRow, tiles->firstRow, TILE_ROWS,
+              tiles->tileRows, rows);
+    tileRange(firstWord, lastWord, tiles->firstWord, TILE_WORDS,
+              tiles->tileCols, cols);
+
+    // Each row of tiles is stepped by one thread, so its flags need no
+    // locking. Thin regions are not worth waking the team for.
+    #pragma omp parallel for schedule(dynamic) \
+            private(tc, run, r, r0, r1, w0, w1, w, diff, active, changed) \
+            if ((long) (lastRow - firstRow + 1) * (lastWord - firstWord + 1) \
+                >= PARALLEL_WORDS)
+    for (tr = rows[0]; tr <= rows[1]; ++tr) {
+        diff    = tiles->diff + (size_t) tr * (tiles->firstWord
+                                               + tiles->numWords);
+        active  = tiles->active  + tr * tiles->tileCols;
+        changed = tiles->changed + tr * tiles->tileCols;
+
+        r0 = tiles->firstRow + tr * TILE_ROWS;
+        r1 = r0 + TILE_ROWS - 1;
+        r0 = r0 < firstRow ? firstRow : r0;
+        r1 = r1 > lastRow  ? lastRow  : r1;
+
+        for (tc = cols[0]; tc <= cols[1]; tc = run + 1) {
+            run = tc;
+            if (!active[tc]) {
+                continue;
+            }
+
+            // Neighboring active tiles are stepped together so the kernel
+            // gets long rows to work on
+            while (run < cols[1] && active[run + 1]) {
+                ++run;
+            }
+
+            w0 = tiles->firstWord + tc * TILE_WORDS;
+            w1 = tiles->firstWord + (run + 1) * TILE_WORDS - 1;
+            w0 = w0 < firstWord ? firstWord : w0;
+            w1 = w1 > lastWord  ? lastWord  : w1;
+
+            memset(diff + w0, 0, (w1 - w0 + 1) * sizeof(uint64_t));
+
+            stepRows(board, next, r0, r1, w0, w1, diff);
+
+            // Births past the last column are masked away, so they are not
+            // changes either, and neither is anything the caller left there
+            if (w0 <= maskWord && maskWord <= w1) {
+                diff[maskWord] = 0;
+                for (r = r0; r <= r1; ++r) {
+                    next[r][maskWord] &= lastMask;
+                    diff[maskWord] |= (next[r][maskWord] ^ board[r][maskWord])
+                                    & lastMask;
+                }
+            }
+
+            // Then see which tiles of the run changed
+            for (; tc <= run; ++tc) {
+                for (w = tiles->firstWord + tc * TILE_WORDS;
+                     w < tiles->firstWord + (tc + 1) * TILE_WORDS; ++w) {
+                    if (w >= w0 && w <= w1 && diff[w] != 0) {
+                        changed[tc] = 1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+void stepBoard(uint64_t** board, uint64_t** next, int numRows, int numWords,
+               uint64_t lastMask) {
+
+    stepRegion(board, next, 1, numRows - 2, 1, numWords, numWords, lastMask);
+}
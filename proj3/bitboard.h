@@ -0,0 +1,170 @@
+// Bit-packed Game of Life board
+//******************************************************************************
+// bitboard.h
+//
+// Summary: Stores 64 cells per 64-bit word and steps whole words of cells at
+//          once with bit-sliced adders instead of counting cell by cell.
+//
+// Author:  agent
+// Created: Oct 2026
+//******************************************************************************
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <stdint.h>
+
+
+#define DEAD '0'
+#define LIVE '1'
+
+#define CELLS_PER_WORD 64
+
+// Number of words needed to hold n cells
+#define WORDS_FOR(n)   (((n) + CELLS_PER_WORD - 1) / CELLS_PER_WORD)
+
+// Words in a packed row: the cells plus a dead guard word on either side
+#define ROW_WORDS(n)   (WORDS_FOR(n) + 2)
+
+// Column c of a row lives in bit (c % 64) of word (c / 64) + 1
+#define CELL_WORD(c)   ((c) / CELLS_PER_WORD + 1)
+#define CELL_BIT(c)    ((uint64_t) 1 << ((c) % CELLS_PER_WORD))
+
+#define GET_CELL(row,c) (((row)[CELL_WORD(c)] & CELL_BIT(c)) != 0)
+#define SET_CELL(row,c) ((row)[CELL_WORD(c)] |= CELL_BIT(c))
+
+// Kernels that setKernel() can pick between
+#define KERNEL_BITSLICE 0
+#define KERNEL_LOOKUP   1
+
+// Rows and words in a tile, the smallest area that can be skipped
+#define TILE_ROWS  16
+#define TILE_WORDS 4
+
+// How setTiles() can have tiles tracked
+#define TILES_AUTO 0   // Until most of them keep changing, then now and then
+#define TILES_ON   1   // Always
+#define TILES_OFF  2   // Never, every tile is stepped every generation
+
+
+// Splits an area of a board into tiles and remembers which of them changed
+// in the last generation. A tile can only change if it or one of the eight
+// tiles around it changed the generation before.
+struct tileMap {
+    int firstRow;            // Board row and word where the first tile starts
+    int firstWord;
+    int numRows;             // Rows and words of the board that are tiled
+    int numWords;
+    int tileRows;            // Tiles down and across
+    int tileCols;
+
+    unsigned char* changed;  // Tile changed in the generation being stepped
+    unsigned char* active;   // Tile has to be stepped in this generation
+    uint64_t*      diff;     // Cells that changed in each row of tiles
+
+    int tracking;            // Changes are being tracked, or else every tile
+                             // is active and counts as changed
+    int busy;                // Generations in a row most tiles were active
+    int untracked;           // Generations until tracking is tried again
+};
+typedef struct tileMap TileMap;
+
+
+// A Life-like rule. Bit n of born is set if a dead cell with n live neighbors
+// comes to life, and bit n of survive if a live cell with n stays alive.
+struct lifeRule {
+    int born;
+    int survive;
+};
+typedef struct lifeRule LifeRule;
+
+
+// Allocates a board of numRows packed rows of rowWords words each, all dead.
+// The rows share one block of storage, release it with freeBoard().
+uint64_t** allocBoard(int numRows, int rowWords);
+
+void freeBoard(uint64_t** board);
+
+
+// Mask of the bits in the last word of a row that hold real cells
+uint64_t lastWordMask(int numCols);
+
+
+// Packs a row of LIVE/DEAD characters into a zeroed packed row
+void packRow(const char* cells, uint64_t* row, int numCols);
+
+
+// Reads a rule written like B3/S23, or B36/S23 for HighLife. Returns 0, or
+// -1 if text is not a rule.
+int parseRule(const char* text, LifeRule* rule);
+
+
+// Steps with rule from now on instead of B3/S23. Rules used often have
+// kernels of their own and the rest share a slower table-driven one. Call
+// it from outside of any parallel region.
+void setRule(const LifeRule* rule);
+
+
+// Steps with kernel from now on. KERNEL_BITSLICE, the default, adds up the
+// neighbors of 64 or more cells at once. KERNEL_LOOKUP looks up each 2x2
+// block of cells in a table of every 4x4 neighborhood. Call it from outside
+// of any parallel region.
+void setKernel(int kernel);
+
+
+// Computes words [firstWord, lastWord] of the next generation of a row from
+// the rows above and below it. The words on either side are read too.
+void stepRow(const uint64_t* above, const uint64_t* row, const uint64_t* below,
+             uint64_t* next, int firstWord, int lastWord);
+
+
+// Writes the next generation of rows [firstRow, lastRow] and words
+// [firstWord, lastWord] of board into next. Word maskWord of each row is
+// ANDed with lastMask when it is stepped, so bits past the last column of
+// the matrix stay dead. Large regions are split between OpenMP threads, so
+// call it from outside of any parallel region.
+void stepRegion(uint64_t** board, uint64_t** next, int firstRow, int lastRow,
+                int firstWord, int lastWord, int maskWord, uint64_t lastMask);
+
+
+// Tracks tiles according to mode from now on, TILES_AUTO by default.
+// Keeping track of which tiles changed costs more than it saves on boards
+// that stay busy all over. Call it before any tiles are created.
+void setTiles(int mode);
+
+
+// Tiles numRows rows and numWords words starting at firstRow and firstWord.
+// Every tile starts out changed. Returns -1 if memory ran out.
+int createTiles(TileMap* tiles, int firstRow, int numRows, int firstWord,
+                int numWords);
+
+void freeTiles(TileMap* tiles);
+
+
+// Starts a generation. Tiles next to one that changed become active and
+// the changes start over. In TILES_AUTO, tracking stops for a while once
+// most tiles have been active for a few generations in a row.
+void activateTiles(TileMap* tiles);
+
+
+// Makes every tile that overlaps rows [firstRow, lastRow] and words
+// [firstWord, lastWord] active, for when cells outside the tiles changed
+void touchTiles(TileMap* tiles, int firstRow, int lastRow, int firstWord,
+                int lastWord);
+
+
+// Same as stepRegion(), but only steps the parts of the region in active
+// tiles and notes which of them changed. Whatever is skipped already holds
+// the right cells in next, since they have not changed for two generations.
+// While tiles are not being tracked it steps the whole region.
+void stepTiles(uint64_t** board, uint64_t** next, TileMap* tiles,
+               int firstRow, int lastRow, int firstWord, int lastWord,
+               int maskWord, uint64_t lastMask);
+
+
+// Writes the next generation of rows [1, numRows-2] of board into next.
+// Rows 0 and numRows-1 are halos that are read but not written.
+void stepBoard(uint64_t** board, uint64_t** next, int numRows, int numWords,
+               uint64_t lastMask);
+
+#endif
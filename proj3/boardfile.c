@@ -0,0 +1,62 @@
+// Binary Game of Life board file
+//******************************************************************************
+// boardfile.c
+//
+// Summary: Writes and checks the header of binary board files.
+//
+// Author:  agent
+// Created: Oct 2026
+//******************************************************************************
+
+#include <string.h>
+
+#include "bitboard.h"
+#include "boardfile.h"
+
+
+void initBoardHeader(BoardHeader* header, int numRows, int numCols,
+                     int packed) {
+
+    memset(header, 0, sizeof(BoardHeader));
+    memcpy(header->magic, BOARD_MAGIC, BOARD_MAGIC_SIZE);
+
+    header->numRows   = numRows;
+    header->numCols   = numCols;
+    header->packed    = packed;
+    header->rowStride = boardRowBytes(numCols, packed);
+    header->dataStart = sizeof(BoardHeader);
+}
+
+
+int readBoardHeader(FILE* file, BoardHeader* header) {
+
+    // Anything that doesn't start with the magic bytes is left alone
+    if (fread(header, sizeof(BoardHeader), 1, file) != 1
+        || memcmp(header->magic, BOARD_MAGIC, BOARD_MAGIC_SIZE) != 0) {
+        rewind(file);
+        return 0;
+    }
+
+    if (header->numRows <= 0 || header->numCols <= 0
+        || (header->packed != 0 && header->packed != 1)
+        || header->generation < 0
+        || header->rowStride < boardRowBytes(header->numCols, header->packed)
+        || header->dataStart < (int64_t) sizeof(BoardHeader)) {
+        return -1;
+    }
+
+    // Packed rows are read a word at a time
+    if (header->packed
+        && (header->rowStride % sizeof(uint64_t) != 0
+            || header->dataStart % sizeof(uint64_t) != 0)) {
+        return -1;
+    }
+
+    return 1;
+}
+
+
+int64_t boardRowBytes(int numCols, int packed) {
+    return packed ? (int64_t) (WORDS_FOR(numCols) * sizeof(uint64_t))
+                  : (int64_t) numCols;
+}
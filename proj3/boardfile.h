@@ -0,0 +1,59 @@
+// Binary Game of Life board file
+//******************************************************************************
+// boardfile.h
+//
+// Summary: A board file that can be read without parsing it. A fixed size
+//          header gives the size of the board and how its rows are stored,
+//          then every row follows at the same stride, either 64 cells to a
+//          word like a packed row of a bitboard or one byte per cell.
+//
+// Author:  agent
+// Created: Oct 2026
+//******************************************************************************
+
+#ifndef BOARDFILE_H
+#define BOARDFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+
+// First bytes of every binary board file. ASCII matrix files start with a
+// digit, so the two can't be mixed up.
+#define BOARD_MAGIC      "LIFEBRD1"
+#define BOARD_MAGIC_SIZE 8
+
+
+// Everything there is to know about a board file before reading its rows.
+// Words and numbers are stored in the byte order of the machine that wrote
+// them, which is little-endian on every host we run on.
+struct boardHeader {
+    char    magic[BOARD_MAGIC_SIZE]; // BOARD_MAGIC
+    int32_t numRows;                 // Rows and columns in the board
+    int32_t numCols;
+    int32_t packed;                  // 1 for 64 cells to a word, column c
+                                     // in bit c % 64 of word c / 64, or 0
+                                     // for one 0 or 1 byte per cell
+    int32_t generation;              // Generations run to get this board,
+                                     // so a checkpoint can be picked up
+    int64_t rowStride;               // Bytes from one row to the next
+    int64_t dataStart;               // Offset of the first row in the file
+};
+typedef struct boardHeader BoardHeader;
+
+
+// Fills in a header for a board with tightly packed rows right after it
+void initBoardHeader(BoardHeader* header, int numRows, int numCols,
+                     int packed);
+
+
+// Reads the header at the start of a file. Returns 1 if it is a binary board
+// file, 0 if it is not and the file is back at its start, or -1 if the header
+// makes no sense.
+int readBoardHeader(FILE* file, BoardHeader* header);
+
+
+// Bytes needed for one row of cells in a board file
+int64_t boardRowBytes(int numCols, int packed);
+
+#endif
@@ -1 +1,4 @@
-mpicc life.c -lm
+mpicc -O3 -fopenmp -pthread life.c bitboard.c boardfile.c patternfile.c -lm
+gcc -O3 hashlife.c -o hashlife
+gcc -O3 lifeconv.c bitboard.c boardfile.c -o lifeconv
+gcc -O3 -pthread threadlife.c bitboard.c boardfile.c -o threadlife
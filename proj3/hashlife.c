@@ -0,0 +1,715 @@
+// HashLife
+//******************************************************************************
+// hashlife.c
+//
+// Summary: Game of Life for very long runs. The board is a quadtree where
+//          identical squares are the same node, and the future of each node
+//          is remembered, so regular patterns jump 2^k generations at a time.
+//          The board is a window on an infinite plane, so it matches life.c
+//          for as long as nothing reaches the edge of the window.
+//
+// Author:  agent
+// Created: Oct 2026
+//******************************************************************************
+
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+#define DEAD '0'
+#define LIVE '1'
+
+
+#define OPEN_FILE_ERROR -1
+#define MALLOC_ERROR    -2
+
+
+#define MAX_LEVEL     62        // Biggest node is 2^62 cells on a side
+#define NODE_CHUNK    65536     // Nodes allocated at a time
+#define DEFAULT_NODES 4000000   // Nodes kept before collecting garbage
+
+
+// A square of 2^level x 2^level cells. Level 0 nodes are single cells, and
+// every other node is made of four quadrants one level down. No two nodes
+// have the same quadrants, so equal squares are always the same node.
+struct node {
+    struct node* nw;        // Quadrants, NULL for single cells
+    struct node* ne;
+    struct node* sw;
+    struct node* se;
+
+    struct node* next;      // Next node in its hash bucket or the free list
+    struct node* result;    // Center of me 2^resultStep generations later
+    int          resultStep;
+
+    int          level;     // log2 of the width
+    int          marked;    // Reached from the board when collecting garbage
+    uint64_t     population;// Live cells
+};
+typedef struct node Node;
+
+
+// Every node that exists, hashed by its quadrants
+struct cache {
+    Node** buckets;
+    size_t numBuckets;      // Always a power of 2
+    size_t numNodes;        // Nodes in the buckets
+    size_t maxNodes;        // Collect garbage once there are more than this
+
+    Node*  freeList;        // Nodes ready to be handed out again
+    Node** chunks;          // Every block of nodes, so they can be freed
+    size_t numChunks;
+
+    Node*  empty[MAX_LEVEL + 1]; // All dead node at each level
+};
+typedef struct cache Cache;
+
+
+static Node  deadCell = {NULL, NULL, NULL, NULL, NULL, NULL, 0, 0, 0, 0};
+static Node  liveCell = {NULL, NULL, NULL, NULL, NULL, NULL, 0, 0, 0, 1};
+static Cache cache;
+
+
+// Seconds since some fixed point, for timing
+double now(void);
+
+
+// Sets up an empty cache that collects garbage past maxNodes nodes
+void createCache(size_t maxNodes);
+
+
+// Frees every node and the cache itself
+void freeCache(void);
+
+
+// Finds or makes the node with these four quadrants
+Node* join(Node* nw, Node* ne, Node* sw, Node* se);
+
+
+// Gets the all dead node at a level
+Node* emptyNode(int level);
+
+
+// Gets the middle half of a node, one level down
+Node* centre(Node* n);
+
+
+// Gets the middle half of a node 2^step generations in the future, where
+// step is at most level - 2. Results are remembered in the node.
+Node* result(Node* n, int step);
+
+
+// Grows the board by a level, keeping the old board in the middle
+Node* expand(Node* root);
+
+
+// Moves the board forward any number of generations
+Node* advance(Node* root, long long generations);
+
+
+// Throws out every node the board no longer uses
+void collectGarbage(Node* root);
+
+
+// Reads a matrix from a file into a board with the matrix in its south east
+// quadrant
+Node* readMatrix(char* filename, int* numRows, int* numCols);
+
+
+// Prints the numRows x numCols window at the corner of the plane in the
+// same format as printSubmatrix() in life.c
+void printBoard(Node* root, int numRows, int numCols);
+
+
+int main(int argc, char* argv[]) {
+
+    static struct option longOptions[] = {
+        {"max-nodes", required_argument, NULL, 'm'},
+        {NULL,        0,                 NULL,  0 }
+    };
+
+    double startTime; // Seconds at start of the program
+    double readTime;  // Seconds at end of reading matrix from file
+    double stepTime;  // Seconds at end of loop
+    double endTime;   // Seconds at end of program
+
+    long long numIterations; // How many generations to run
+    long long printMod;      // How frequently to print out the matrix
+    long long done;          // Generations run so far
+    long long chunk;         // Generations until the next print
+    long long maxNodes;      // Nodes kept before collecting garbage
+
+    int numRows;      // Dimensions of the matrix
+    int numCols;
+    int opt;
+
+    Node* root;       // The whole board, with the matrix at its center
+
+    // Check command line arguments
+    maxNodes = DEFAULT_NODES;
+
+    while ((opt = getopt_long(argc, argv, "", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'm':
+                maxNodes = atoll(optarg);
+                if (maxNodes <= 0) {
+                    printf("\nError: max nodes must be a positive integer\n\n");
+                    return 5;
+                }
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+
+    if (argc - optind != 3) {
+        printf("\nUsage: %s [options] filename iterations printFrequency\n"
+               "  --max-nodes N  nodes kept before collecting garbage, "
+               "%d by default\n", argv[0], DEFAULT_NODES);
+        return 1;
+    }
+
+    numIterations = atoll(argv[optind + 1]);
+    if (numIterations <= 0) {
+        printf("\nError: number of iterations must be a positive integer");
+        return 3;
+    }
+
+    printMod = atoll(argv[optind + 2]);
+    if (printMod < 0) {
+        printf("\nError: print frequency cannot be negative\n\n");
+        return 4;
+    }
+
+    startTime = now();
+
+
+    // Read the matrix in and print it once before modifying it
+    createCache((size_t) maxNodes);
+    root = readMatrix(argv[optind], &numRows, &numCols);
+
+    printBoard(root, numRows, numCols);
+
+    readTime = now();
+
+
+    // Jump straight from one print to the next
+    for (done = 0; done < numIterations; done += chunk) {
+        chunk = numIterations - done;
+        if (printMod != 0 && chunk > printMod) {
+            chunk = printMod;
+        }
+
+        root = advance(root, chunk);
+
+        if (printMod != 0 && (done + chunk) % printMod == 0) {
+            printf("\n\n");
+            printBoard(root, numRows, numCols);
+        }
+    }
+
+    stepTime = now();
+
+    // Print out the resulting matrix
+    printf("\n\n");
+    printBoard(root, numRows, numCols);
+
+
+    // Print runtimes to stderr so stdout can be piped to /dev/null. The
+    // last one is how many nodes were left in the cache.
+    endTime = now();
+    fprintf(stderr, "1,%d,%d,%lld,%lld,%.15f,%.15f,%.15f,%zu\n", numRows,
+                    numCols, printMod, numIterations, readTime-startTime,
+                    stepTime-startTime, endTime-startTime, cache.numNodes);
+
+    freeCache();
+    return 0;
+}
+
+
+
+
+double now(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+
+void createCache(size_t maxNodes) {
+
+    memset(&cache, 0, sizeof(cache));
+
+    cache.numBuckets = 1024;
+    cache.maxNodes   = maxNodes;
+    cache.buckets    = (Node**) calloc(cache.numBuckets, sizeof(Node*));
+
+    if (cache.buckets == NULL) {
+        exit(MALLOC_ERROR);
+    }
+}
+
+
+void freeCache(void) {
+    size_t i;
+
+    for (i = 0; i < cache.numChunks; ++i) {
+        free(cache.chunks[i]);
+    }
+
+    free(cache.chunks);
+    free(cache.buckets);
+}
+
+
+// Hands out a node, allocating another chunk of them when none are free
+static Node* allocNode(void) {
+    Node*  chunk;
+    Node** chunks;
+    Node*  n;
+    int    i;
+
+    if (cache.freeList == NULL) {
+        chunk  = (Node*)  malloc(NODE_CHUNK * sizeof(Node));
+        chunks = (Node**) realloc(cache.chunks,
+                                  (cache.numChunks + 1) * sizeof(Node*));
+
+        if (chunk == NULL || chunks == NULL) {
+            exit(MALLOC_ERROR);
+        }
+
+        cache.chunks = chunks;
+        cache.chunks[cache.numChunks++] = chunk;
+
+        for (i = 0; i < NODE_CHUNK; ++i) {
+            chunk[i].next  = cache.freeList;
+            cache.freeList = &chunk[i];
+        }
+    }
+
+    n = cache.freeList;
+    cache.freeList = n->next;
+    return n;
+}
+
+
+// Mixes the addresses of the quadrants into a bucket number
+static size_t hashQuadrants(Node* nw, Node* ne, Node* sw, Node* se) {
+    uint64_t h = (uintptr_t) nw;
+
+    h = h * 0x9E3779B97F4A7C15ULL + (uintptr_t) ne;
+    h = h * 0x9E3779B97F4A7C15ULL + (uintptr_t) sw;
+    h = h * 0x9E3779B97F4A7C15ULL + (uintptr_t) se;
+
+    return (size_t) (h ^ (h >> 31)) & (cache.numBuckets - 1);
+}
+
+
+// Doubles the number of buckets so the chains stay short
+static void growBuckets(void) {
+    Node** oldBuckets = cache.buckets;
+    size_t oldSize    = cache.numBuckets;
+    size_t b;
+    size_t h;
+    Node*  n;
+    Node*  next;
+
+    cache.buckets = (Node**) calloc(oldSize * 2, sizeof(Node*));
+    if (cache.buckets == NULL) {
+        exit(MALLOC_ERROR);
+    }
+    cache.numBuckets = oldSize * 2;
+
+    for (b = 0; b < oldSize; ++b) {
+        for (n = oldBuckets[b]; n != NULL; n = next) {
+            next = n->next;
+            h    = hashQuadrants(n->nw, n->ne, n->sw, n->se);
+            n->next = cache.buckets[h];
+            cache.buckets[h] = n;
+        }
+    }
+
+    free(oldBuckets);
+}
+
+
+Node* join(Node* nw, Node* ne, Node* sw, Node* se) {
+    size_t h = hashQuadrants(nw, ne, sw, se);
+    Node*  n;
+
+    // Hand back the node if it already exists
+    for (n = cache.buckets[h]; n != NULL; n = n->next) {
+        if (n->nw == nw && n->ne == ne && n->sw == sw && n->se == se) {
+            return n;
+        }
+    }
+
+    n = allocNode();
+    n->nw = nw;
+    n->ne = ne;
+    n->sw = sw;
+    n->se = se;
+
+    n->result     = NULL;
+    n->resultStep = -1;
+    n->level      = nw->level + 1;
+    n->marked     = 0;
+    n->population = nw->population + ne->population
+                  + sw->population + se->population;
+
+    n->next = cache.buckets[h];
+    cache.buckets[h] = n;
+
+    if (++cache.numNodes > cache.numBuckets) {
+        growBuckets();
+    }
+
+    return n;
+}
+
+
+Node* emptyNode(int level) {
+    Node* below;
+
+    if (level == 0) {
+        return &deadCell;
+    }
+
+    if (cache.empty[level] == NULL) {
+        below = emptyNode(level - 1);
+        cache.empty[level] = join(below, below, below, below);
+    }
+
+    return cache.empty[level];
+}
+
+
+Node* centre(Node* n) {
+    return join(n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+}
+
+
+// Gets a cell of a 4 x 4 node, counting rows and columns from the top left
+static int cellOf(Node* n, int r, int c) {
+    Node* q = r < 2 ? (c < 2 ? n->nw : n->ne) : (c < 2 ? n->sw : n->se);
+
+    r %= 2;
+    c %= 2;
+    q  = r == 0 ? (c == 0 ? q->nw : q->ne) : (c == 0 ? q->sw : q->se);
+
+    return q->population != 0;
+}
+
+
+// Steps the middle 2 x 2 cells of a 4 x 4 node one generation by counting
+static Node* stepLeaf(Node* n) {
+    Node* cell[4];
+    int   count;
+    int   r;
+    int   c;
+    int   dr;
+    int   dc;
+
+    for (r = 1; r <= 2; ++r) {
+        for (c = 1; c <= 2; ++c) {
+            count = 0;
+            for (dr = -1; dr <= 1; ++dr) {
+                for (dc = -1; dc <= 1; ++dc) {
+                    if (dr != 0 || dc != 0) {
+                        count += cellOf(n, r + dr, c + dc);
+                    }
+                }
+            }
+
+            // Born with 3 neighbors, survive with 2 or 3
+            cell[(r-1) * 2 + (c-1)] =
+                (count == 3 || (count == 2 && cellOf(n, r, c)))
+                ? &liveCell : &deadCell;
+        }
+    }
+
+    return join(cell[0], cell[1], cell[2], cell[3]);
+}
+
+
+Node* result(Node* n, int step) {
+
+    Node* n00; Node* n01; Node* n02;   // Nine overlapping squares, each half
+    Node* n10; Node* n11; Node* n12;   // as wide as n
+    Node* n20; Node* n21; Node* n22;
+
+    int asked = step; // Step to remember the result under
+
+    if (n->population == 0) {
+        return emptyNode(n->level - 1);
+    }
+
+    if (n->result != NULL && n->resultStep == step) {
+        return n->result;
+    }
+
+    if (n->level == 2) {
+        n->result = stepLeaf(n);
+        n->resultStep = asked;
+        return n->result;
+    }
+
+    n00 = n->nw;
+    n01 = join(n->nw->ne, n->ne->nw, n->nw->se, n->ne->sw);
+    n02 = n->ne;
+    n10 = join(n->nw->sw, n->nw->se, n->sw->nw, n->sw->ne);
+    n11 = centre(n);
+    n12 = join(n->ne->sw, n->ne->se, n->se->nw, n->se->ne);
+    n20 = n->sw;
+    n21 = join(n->sw->ne, n->se->nw, n->sw->se, n->se->sw);
+    n22 = n->se;
+
+    // Take half the steps on the nine squares to get their centers, or at
+    // slower speeds just cut out their centers, then take the rest on the
+    // four squares those make
+    if (step == n->level - 2) {
+        n00 = result(n00, step - 1);  n01 = result(n01, step - 1);
+        n02 = result(n02, step - 1);  n10 = result(n10, step - 1);
+        n11 = result(n11, step - 1);  n12 = result(n12, step - 1);
+        n20 = result(n20, step - 1);  n21 = result(n21, step - 1);
+        n22 = result(n22, step - 1);
+        step -= 1;
+    } else {
+        n00 = centre(n00);  n01 = centre(n01);  n02 = centre(n02);
+        n10 = centre(n10);  n11 = centre(n11);  n12 = centre(n12);
+        n20 = centre(n20);  n21 = centre(n21);  n22 = centre(n22);
+    }
+
+    n->result = join(result(join(n00, n01, n10, n11), step),
+                     result(join(n01, n02, n11, n12), step),
+                     result(join(n10, n11, n20, n21), step),
+                     result(join(n11, n12, n21, n22), step));
+    n->resultStep = asked;
+    return n->result;
+}
+
+
+Node* expand(Node* root) {
+    Node* e = emptyNode(root->level - 1);
+
+    if (root->level >= MAX_LEVEL) {
+        fprintf(stderr, "\nError: the pattern grew past 2^%d cells\n\n",
+                MAX_LEVEL);
+        exit(MALLOC_ERROR);
+    }
+
+    return join(join(e, e, e, root->nw), join(e, e, root->ne, e),
+                join(e, root->sw, e, e), join(root->se, e, e, e));
+}
+
+
+Node* advance(Node* root, long long generations) {
+    int step;
+
+    // Take the largest jumps first, one for each bit of the count
+    for (step = MAX_LEVEL - 3; step >= 0; --step) {
+        if ((generations >> step & 1) == 0) {
+            continue;
+        }
+
+        // Cells move at most one square a generation, so the board needs
+        // room for them around its middle quarter before the jump
+        while (root->level < step + 3
+               || centre(centre(root))->population != root->population) {
+            root = expand(root);
+        }
+
+        root = result(root, step);
+
+        if (cache.numNodes > cache.maxNodes) {
+            collectGarbage(root);
+        }
+    }
+
+    return root;
+}
+
+
+// Marks every node reachable from n
+static void markNode(Node* n) {
+    if (n->level == 0 || n->marked) {
+        return;
+    }
+
+    n->marked = 1;
+    markNode(n->nw);
+    markNode(n->ne);
+    markNode(n->sw);
+    markNode(n->se);
+}
+
+
+void collectGarbage(Node* root) {
+    size_t b;
+    int    level;
+    Node** link;
+    Node*  n;
+
+    markNode(root);
+    for (level = 1; level <= MAX_LEVEL; ++level) {
+        if (cache.empty[level] != NULL) {
+            markNode(cache.empty[level]);
+        }
+    }
+
+    // Forget results that are about to be thrown out
+    for (b = 0; b < cache.numBuckets; ++b) {
+        for (n = cache.buckets[b]; n != NULL; n = n->next) {
+            if (n->marked && n->result != NULL && n->result->level > 0
+                && !n->result->marked) {
+                n->result = NULL;
+            }
+        }
+    }
+
+    // Move everything unmarked to the free list
+    for (b = 0; b < cache.numBuckets; ++b) {
+        link = &cache.buckets[b];
+
+        while ((n = *link) != NULL) {
+            if (n->marked) {
+                n->marked = 0;
+                link = &n->next;
+            } else {
+                *link = n->next;
+                n->next = cache.freeList;
+                cache.freeList = n;
+                --cache.numNodes;
+            }
+        }
+    }
+}
+
+
+// Builds the node at the given level whose top left corner is at row r and
+// column c, out of a numRows x numCols array of cells
+static Node* buildNode(char* cells, int numRows, int numCols, int level,
+                       long long r, long long c) {
+    long long half;
+
+    if (r >= numRows || c >= numCols) {
+        return emptyNode(level);
+    }
+
+    if (level == 0) {
+        return cells[r * numCols + c] == LIVE ? &liveCell : &deadCell;
+    }
+
+    half = 1LL << (level - 1);
+
+    return join(buildNode(cells, numRows, numCols, level - 1, r, c),
+                buildNode(cells, numRows, numCols, level - 1, r, c + half),
+                buildNode(cells, numRows, numCols, level - 1, r + half, c),
+                buildNode(cells, numRows, numCols, level - 1, r + half,
+                          c + half));
+}
+
+
+Node* readMatrix(char* filename, int* numRows, int* numCols) {
+
+    FILE* matrixFile; // File pointer for matrix file
+    char* cells;      // Every cell of the matrix as LIVE/DEAD characters
+    char  junk;       // Somewhere to toss newlines
+    int   level;      // Level of a quadrant big enough for the matrix
+    int   r;
+    Node* quadrant;
+    Node* e;
+
+    matrixFile = fopen(filename, "r");
+
+    if (matrixFile == NULL
+        || fscanf(matrixFile, "%d %d", numRows, numCols) != 2
+        || *numRows <= 0 || *numCols <= 0) {
+
+        exit(OPEN_FILE_ERROR);
+    }
+
+    cells = (char*) malloc((size_t) *numRows * *numCols);
+    if (cells == NULL) {
+        exit(MALLOC_ERROR);
+    }
+
+    // Read in rows, each after a newline
+    for (r = 0; r < *numRows; ++r) {
+        if (fscanf(matrixFile, "%c", &junk) != 1
+            || fread(cells + (size_t) r * *numCols, sizeof(char), *numCols,
+                     matrixFile) != (size_t) *numCols) {
+
+            exit(OPEN_FILE_ERROR);
+        }
+    }
+
+    fclose(matrixFile);
+
+
+    // The matrix is the south east quadrant, so it starts at the center of
+    // the board and the center never moves as the board grows and shrinks
+    for (level = 1; (1LL << level) < *numRows
+                    || (1LL << level) < *numCols; ++level) {
+    }
+
+    quadrant = buildNode(cells, *numRows, *numCols, level, 0, 0);
+    e        = emptyNode(level);
+
+    free(cells);
+    return join(e, e, e, quadrant);
+}
+
+
+// Writes the live cells of n into a numRows x numCols window, where the top
+// left corner of n is at row r and column c of the window
+static void drawNode(Node* n, char* window, int numRows, int numCols,
+                     long long r, long long c) {
+    long long width = 1LL << n->level;
+    long long half  = width / 2;
+
+    // Skip squares that are dead or outside the window
+    if (n->population == 0 || r >= numRows || c >= numCols
+        || r + width <= 0 || c + width <= 0) {
+        return;
+    }
+
+    if (n->level == 0) {
+        window[r * (numCols + 1) + c] = '+';
+        return;
+    }
+
+    drawNode(n->nw, window, numRows, numCols, r, c);
+    drawNode(n->ne, window, numRows, numCols, r, c + half);
+    drawNode(n->sw, window, numRows, numCols, r + half, c);
+    drawNode(n->se, window, numRows, numCols, r + half, c + half);
+}
+
+
+void printBoard(Node* root, int numRows, int numCols) {
+    char*     window;   // Rows of '+' and ' ', each ending in a newline
+    long long corner;   // Row and column of the board's top left corner
+    int       r;
+
+    window = (char*) malloc((size_t) numRows * (numCols + 1));
+    if (window == NULL) {
+        exit(MALLOC_ERROR);
+    }
+
+    memset(window, ' ', (size_t) numRows * (numCols + 1));
+    for (r = 0; r < numRows; ++r) {
+        window[(size_t) r * (numCols + 1) + numCols] = '\n';
+    }
+
+    corner = -(1LL << (root->level - 1));
+    drawNode(root, window, numRows, numCols, corner, corner);
+
+    fwrite(window, sizeof(char), (size_t) numRows * (numCols + 1), stdout);
+    free(window);
+}
@@ -1,499 +1,3966 @@
-// Game of Life
-//******************************************************************************
-// life.cpp
-//
-// Summary: Simulation of Conway's game of Life. Cells live and die.
-//
-// Authors: Spencer Pullins & Blake Lasky
-// Created: Oct 2016
-//******************************************************************************
-
-#include <mpi.h>
-#include <math.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <time.h>
-
-
-#define DEAD '0'
-#define LIVE '1'
-
-#define DATA_MSG     0
-#define PROMPT_MSG   1
-#define RESPONSE_MSG 2
-
-
-#define OPEN_FILE_ERROR -1
-#define MALLOC_ERROR    -2
-
-
-#define MIN(a,b) 	         ((a) < (b) ? (a) : (b))
-#define BLOCK_LOW(id,p,n)    ((id)*(n)/(p))
-#define BLOCK_HIGH(id,p,n)   (BLOCK_LOW((id)+1,p,n) - 1)
-#define BLOCK_SIZE(id,p,n)   (BLOCK_LOW((id)+1,p,n) - BLOCK_LOW(id,p,n))
-#define BLOCK_OWN(index,p,n) (((p)*((index)+1)-1)/(n))
-
-
-// Used for storing the number of rows and columns in the matrix
-struct dimensions {
-    int numRows;
-    int numCols;
-};
-typedef struct dimensions Dimensions;
-
-
-// Reads a matrix from a file and sends the blocks to coreesponding processes
-void readRowStripedMatrix(
-    char*       filename,    // Name of file with matrix
-    char***     subMatrix,   // Pointer to submatrix
-    char**      bulkStorage, // Bulk storage of sub matrix
-    Dimensions* dimension,   // Rows and cols in submatrix
-    int         myRank,
-    int         numProcs);
-
-
-// Exchanges rows up and down so everyone has what they need each iteration
-void exchangeRows(char** matrix, int rank, int numProcs, int rows, int cols);
-
-
-// Prints out a matrix that is rows x cols
-void printSubmatrix(char **subMatrix, int rows, int cols);
-
-
-// Gets all row information from processes and prints the matrix
-void printRowStripedMatrix(char** subMatrix, int numRows, 
-                            int myRows, int myCols, int myRank, int numProcs);
-
-int main(int argc, char* argv[]) {
-
-    double startTime; // Seconds at start of the program
-    double seqToPar;  // Seconds at end of reading matrix from file
-    double parToSeq;  // Seconds at end of loop
-    double endTime;   // Seconds at end of program
-
-    int myRank;       // Which number process I am [0, (n-1)]
-    int numProcs;     // How many processes there are going to be
-
-    int i;   // Used for iterating things
-    int r;   // Used for iterating rows
-    int c;   // Used for iteration columns
-    int sum; // Used for summing somethings
-    
-    const int MAX_FILE_LEN = 256; // Maximum length of a filename
-    char filename[MAX_FILE_LEN];  // Filename of matrix
-
-    char* bulkStorage;    // Bulk storage for my portion of the matrix
-    char** matrix;        // 2D version of bulk storage                
-
-    Dimensions d;         // Dimensions of global matrix
-    int myRows;           // Dimensions of my matrix
-    int myCols;
-
-    int*  counterStorage; // Bulk storage for counting neighbors
-    int** counter;        // 2D version of the above
-
-    int printMod;         // Command line arguments for number of iterations
-    int numIterations;    // and how frequenctly to print out the matrix
-
-
-
-    // Check command line arguments
-    if (argc != 4) {
-        printf("\nUsage: %s filename iterations printFrequency\n", argv[0]);
-        return 1;
-    }
-
-    // Parse command line arguments
-    numIterations = atoi(argv[2]);
-    if (numIterations <= 0) {
-        printf("\nError: number of iterations must be a positive integer");
-        return 3;
-    }
-
-    printMod = atoi(argv[3]);
-    if (printMod < 0) {
-        printf("\nError: print frequency cannot be negative\n\n");
-        return 4;
-    }
-
-    strncpy(filename, argv[1], sizeof(filename)); 
-
-
-	// Begin MPI
-    MPI_Init(&argc, &argv);
-    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
-    MPI_Comm_size(MPI_COMM_WORLD, &numProcs);
-
-    startTime = MPI_Wtime();
-
-
-    // Read the matrix in from file and get my portion of it
-    readRowStripedMatrix(filename, &matrix, &bulkStorage, &d, myRank, numProcs);
-
-
-    // How big will my portion of the matrix be?
-    myRows = BLOCK_SIZE(myRank, numProcs, d.numRows) + 2;
-    myCols = d.numCols + 2;
-
-
-    // Allocate storage for neighbor counting
-    counterStorage = (int*)  malloc((myRows-2)*(myCols-2)*sizeof(int));
-    counter        = (int**) malloc((myRows-2)*sizeof(int*));
-
-    // Exit if memory allocation failed
-    if (counterStorage == NULL || counter == NULL) {
-        MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
-    }
-
-    // Link up sub-matrtix
-    counter[0] = counterStorage;
-    for (i = 1; i < myRows-2; ++i) {
-        counter[i] = counter[i-1] + (myCols-2);
-    }
-
-
-    // Print matrix once before modifying it
-    printRowStripedMatrix(matrix, d.numRows, myRows, myCols, myRank, numProcs);
-
-    // BEGIN parallel operations
-    seqToPar = MPI_Wtime();
-
-    for (i = 0; i < numIterations; ++i) {
-        // Get the top row from below and bottom row from above
-        exchangeRows(matrix, myRank, numProcs, myRows, myCols);
-
-        // Count how many neighbors everyone has
-        for (r = 1; r < myRows-1; ++r) {
-            sum = 0;
-            for (c = 1; c < myCols - 1; ++c) {
-                sum =  matrix[r-1][c-1];
-                sum += matrix[r-1][c];
-                sum += matrix[r-1][c+1];
-
-                sum += matrix[r][c-1];
-                sum += matrix[r][c+1];
-
-                sum += matrix[r+1][c-1];
-                sum += matrix[r+1][c];
-                sum += matrix[r+1][c+1];
-
-                counter[r-1][c-1] = sum;
-            }
-        }
-
-        // Execute/resurrect based on number of neighbors
-        for (r = 1; r < myRows-1; ++r) {
-            for (c = 1; c < myCols - 1; ++c) {
-                switch (counter[r-1][c-1]) {
-                    case 2:
-                        break;
-                    case 3:
-                        matrix[r][c] = 1;
-                        break;
-                    default:
-                        matrix[r][c] = 0;
-                        break;
-                }
-            }
-        }
-
-
-        // Print out the matrix
-        if (printMod != 0 && (i % printMod) == printMod-1) {
-            if (myRank == 0) {
-                printf("\n\n");
-            }
-            printRowStripedMatrix(matrix, d.numRows, myRows, myCols, 
-                                    myRank, numProcs);
-        }
-    }
-
-    // END parallel operatinos
-    parToSeq = MPI_Wtime();
-
-    // Print out the resulting matrix
-    if (myRank == 0) {
-        printf("\n\n");
-    }
-    printRowStripedMatrix(matrix, d.numRows, myRows, myCols, myRank, numProcs);
-    
-    
-    // Free dynami memory
-    free(counterStorage);
-    free(counter);
-
-    free(bulkStorage);
-    free(matrix);
-
-    // Print runtimes to stderr so stdout can be piped to /dev/null
-    endTime = MPI_Wtime();
-    if (myRank == 0) {
-       fprintf(stderr, "%d,%d,%d,%d,%d,%.15f,%.15f,%.15f\n", numProcs,
-                     d.numRows, d.numCols, printMod, numIterations,
-                     seqToPar-startTime, parToSeq-startTime, endTime-startTime); 
-    }
-
-    MPI_Finalize();
-    return 0;
-}
-
-
-
-
-void readRowStripedMatrix(char* filename, char*** subMatrix, char** bulkStorage,
-                          Dimensions* dimension, int myRank, int numProcs) {
-
-    char** myMatrix;  // Dereferennced version of subMatrix
-    char*  myStorage; // Dereferenced version of bulkStorage
-
-    int* numRows;     // Rows and cols in global matrix
-    int* numCols; 
-    int myRows;       // Rows and cols in my portion of matrix
-    int myCols;
-
-    FILE* matrixFile; // File pointer for matrix file
-    int bytesRead;    // Used with fread to see how much data was read
-
-    int myLow;        // Low for current process receiving matrix data
-    int size;         // How many rows a process has, used for distribution
-    int nextLow;      // Low for next process receiving matrix data
-
-    int i;
-    int r;
-    int c;
-    char junk;        // Somewhere to toss newlines
-
-    MPI_Status status;
-
-    // Point to the varibles inside dimension
-    numRows = &(dimension->numRows);
-    numCols = &(dimension->numCols);
-
-    // Read in matrix dimensions
-    if (myRank == (numProcs - 1)) {
-        matrixFile = fopen(filename, "r");
-        
-        if (matrixFile == NULL 
-            || fscanf(matrixFile, "%d %d", numRows, numCols) != 2) {
-
-            MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
-        }
-    }
-
-    // Send dimensions to every process
-    MPI_Bcast(dimension, sizeof(Dimensions), MPI_INT, numProcs-1, MPI_COMM_WORLD);
-    if (*numRows == 0) {
-        MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
-    }
-
-
-    // Allocate storage 
-    myRows = BLOCK_SIZE(myRank, numProcs, *numRows) + 2;
-    myCols = *numCols + 2;
-
-    *bulkStorage = (char*)  malloc(myRows * myCols * sizeof(char));
-    *subMatrix   = (char**) malloc(myRows * sizeof(char*));
-
-    myMatrix  = *subMatrix;
-    myStorage = *bulkStorage;
-
-
-    // Exit if memory allocation failed
-    if (bulkStorage == NULL || subMatrix == NULL) {
-        MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
-    }
-
-
-    // Link up sub-matrtix
-    myMatrix[0] = *bulkStorage;
-    for (i = 1; i < myRows; ++i) {
-        myMatrix[i] = myMatrix[i-1] + myCols;
-    }
-
-
-    // Broadcast matrix data
-    if (myRank == (numProcs - 1)) {
-
-        myLow = 0;
-        for (i = 0; i < numProcs; ++i) {
-            // Use nextLow to avoid redundent computation
-            nextLow = BLOCK_LOW(i+1, numProcs, *numRows);
-            size = nextLow - myLow;
-
-            // Setup myLow for next iteration
-            myLow = nextLow;
-                
-            // Fill top and bottom row with 0's
-            for (c = 0; c < myCols; ++c) {
-                myMatrix[0][c] = 0;
-                myMatrix[size + 1][c] = 0;
-            }
-
-
-
-
-            // Read in rows
-            bytesRead = 0;
-            for (r = 0; r < size; ++r) {
-
-                // Remove newline character
-                if (fscanf(matrixFile, "%c", &junk) != 1) {
-                    MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
-                }
-                
-                // Read row and add 0's to front and back of row
-                bytesRead += fread(myMatrix[r+1] + 1, sizeof(char),
-                                    *numCols, matrixFile);
-
-                myMatrix[r+1][0]        = 0;
-                myMatrix[r+1][myCols-1] = 0;
-            }
-
-            if (bytesRead != size * (*numCols)) {
-                MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
-            }
-
-
-            // I don't need to send data to myself
-            if (i != myRank) {
-                MPI_Send(myStorage, (size + 2) * myCols, MPI_CHAR, i,
-                            DATA_MSG, MPI_COMM_WORLD);
-            }
-        }
-
-        close(matrixFile);
-
-    } else {
-        // Receive matrix data
-        MPI_Recv(myStorage, myRows * myCols, MPI_CHAR, numProcs - 1,
-                    DATA_MSG, MPI_COMM_WORLD, &status);
-    }
-
-    for (i = 0; i < myRows*myCols; ++i) {
-        if ((*bulkStorage)[i] == LIVE) {
-            (*bulkStorage)[i] = 1;
-        } else {
-            (*bulkStorage)[i] = 0;
-        }
-    }
-
-}
-
-
-void exchangeRows(char** matrix, int rank, int numProcs, int rows, int cols) {
-    
-    MPI_Status status;
-
-    // If I am not process 0, send my bottom row to the process below me
-    if (rank > 0) {
-         MPI_Send(matrix[1], cols, MPI_CHAR, rank - 1, 
-                     DATA_MSG, MPI_COMM_WORLD);
-    }
- 
-    // If there is a process above me, get their bottom row and send them my top
-    if (rank < numProcs - 1) {
-         MPI_Recv(matrix[rows - 1], cols, MPI_CHAR, rank + 1,
-                     DATA_MSG, MPI_COMM_WORLD, &status);
- 
-         MPI_Send(matrix[rows - 2], cols, MPI_CHAR, rank + 1, 
-                     DATA_MSG, MPI_COMM_WORLD);
-    }
-    
-    // If There is someone below me, get their top row
-    if (rank > 0) {
-         MPI_Recv(matrix[0], cols, MPI_CHAR, rank - 1,
-                     DATA_MSG, MPI_COMM_WORLD, &status);
-    }
-}
-
-
-void printRowStripedMatrix(char** subMatrix, int numRows, 
-                            int myRows, int myCols, int myRank, int numProcs) {
-    
-    char*  bulkStorage;     // Temporary storage for data from other processes
-    char** receivedMatrix;
-
-    int i;
-
-    int maxRows;
-    int myLow;
-    int nextLow;
-    int size;
-
-    MPI_Status status;
-    int prompt;
-
-
-    if (myRank == 0) {
-        // Print my submatrix
-        printSubmatrix(subMatrix, myRows, myCols);
-
-        // Print everyone elses
-        if (numProcs > 1) {
-
-            // Allocate and storage and hookup 2D matrix
-            maxRows = BLOCK_SIZE(numProcs-1, numProcs, numRows) + 2;
-            bulkStorage    = (char*)  malloc(maxRows * myCols);
-            receivedMatrix = (char**) malloc(maxRows * sizeof(char*));
-
-            if (bulkStorage == NULL || receivedMatrix == NULL) {
-                MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
-            }
-
-            receivedMatrix[0] = bulkStorage;
-            for (i = 1; i < maxRows; ++i) {
-                receivedMatrix[i] = receivedMatrix[i-1] + myCols;
-            }
-
-            
-            // Receive matrices from everyone else and print them out
-            myLow = BLOCK_LOW(1, numProcs, numRows);
-            for (i = 1; i < numProcs; ++i) {
-                // Calculate size of matrix to be received from process i
-                nextLow = BLOCK_LOW(i+1, numProcs, numRows);
-                size = nextLow - myLow + 2;
-                myLow = nextLow;
-
-                MPI_Send(&prompt, 1, MPI_INT, i, PROMPT_MSG, MPI_COMM_WORLD);
-
-
-                MPI_Recv(bulkStorage, size*myCols, MPI_CHAR, i, RESPONSE_MSG,
-                            MPI_COMM_WORLD, &status);
-
-                printSubmatrix(receivedMatrix, size, myCols);
-            }
-    
-            free(receivedMatrix);
-            free(bulkStorage);
-        }
-
-    } else {
-        // If I am not process 0, send my submatrix to him
-        MPI_Recv(&prompt, 1, MPI_INT, 0, PROMPT_MSG, MPI_COMM_WORLD, &status);
-        MPI_Send(*subMatrix, myRows*myCols, MPI_CHAR, 0, 
-                    RESPONSE_MSG, MPI_COMM_WORLD);
-    }
-}
-
-
-void printSubmatrix(char **subMatrix, int rows, int cols) {
-    int r;
-    int c;
-
-    for (r = 1; r < rows - 1; ++r) {
-        for (c = 1; c < cols - 1; ++c) {
-            printf("%c", (subMatrix[r][c]) == 0 ? ' ' : '+');
-       }
-       printf("\n");
-    }
-}
-
-
-
-
-
-
-
-
-
+// Game of Life
+//******************************************************************************
+// life.cpp
+//
+// Summary: Simulation of Conway's game of Life. Cells live and die.
+//
+// Authors: Spencer Pullins & Blake Lasky
+// Created: Oct 2016
+//******************************************************************************
+
+#include <mpi.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "bitboard.h"
+#include "boardfile.h"
+#include "patternfile.h"
+
+
+#define DATA_MSG     0
+#define PROMPT_MSG   1
+#define RESPONSE_MSG 2
+#define HALO_MSG     3   // HALO_MSG + direction the halo travels
+#define MIGRATE_MSG  (HALO_MSG + NUM_DIRS) // Rows moving to a neighbor
+
+
+#define OPEN_FILE_ERROR -1
+#define MALLOC_ERROR    -2
+#define GRID_ERROR      -3
+
+
+// Process rows whose step times are within this fraction of the average
+// are left alone by rebalancing
+#define REBALANCE_SLACK 0.05
+
+
+// Snapshots that can wait to be written while the generations after them
+// are stepped
+#define OUTPUT_BUFFERS 2
+
+
+#define MIN(a,b) 	         ((a) < (b) ? (a) : (b))
+#define MAX(a,b)             ((a) > (b) ? (a) : (b))
+#define BLOCK_LOW(id,p,n)    ((id)*(n)/(p))
+#define BLOCK_HIGH(id,p,n)   (BLOCK_LOW((id)+1,p,n) - 1)
+#define BLOCK_SIZE(id,p,n)   (BLOCK_LOW((id)+1,p,n) - BLOCK_LOW(id,p,n))
+#define BLOCK_OWN(index,p,n) (((p)*((index)+1)-1)/(n))
+
+
+// Directions to the eight neighboring blocks. North is toward row 0 and
+// west is toward column 0, and opposite directions add up to NUM_DIRS - 1.
+#define NORTH      0
+#define WEST       1
+#define NORTH_WEST 2
+#define NORTH_EAST 3
+#define SOUTH_WEST 4
+#define SOUTH_EAST 5
+#define EAST       6
+#define SOUTH      7
+#define NUM_DIRS   8
+
+#define OPPOSITE(dir) (NUM_DIRS - 1 - (dir))
+
+
+// How snapshots are written, when they go to files
+#define SNAPSHOT_ASCII  0   // The same format as matrix files
+#define SNAPSHOT_BINARY 1   // Packed binary board files
+
+
+// How halos get from my neighbors to me
+#define TRANSPORT_ISEND      0  // A new send and receive for every edge
+#define TRANSPORT_PERSISTENT 1  // The same sends and receives started again
+#define TRANSPORT_PSCW       2  // Edges put straight into my neighbors'
+                                // blocks, one access epoch per exchange
+#define TRANSPORT_SHARED     3  // Halo rows of a neighbor on my node are
+                                // its own rows, read where they are
+
+
+// What each process spends its time on, timed around every call
+#define PHASE_READ      0   // Reading or generating the matrix
+#define PHASE_EXCHANGE  1   // Sending and receiving halos
+#define PHASE_STEP      2   // Counting neighbors and writing the next cells
+#define PHASE_REBALANCE 3   // Moving rows between processes
+#define PHASE_ANALYSIS  4   // Stats and looking for a repeat
+#define PHASE_OUTPUT    5   // Printing, snapshots and checkpoints
+#define NUM_PHASES      6
+
+
+// Used for storing the number of rows and columns in the matrix
+struct dimensions {
+    int numRows;
+    int numCols;
+};
+typedef struct dimensions Dimensions;
+
+
+// Where the rows of the matrix are in its file
+struct fileLayout {
+    int        binary;    // Binary board file instead of ASCII
+    int        packed;    // Binary rows are 64 cells to a word, not bytes
+    MPI_Offset dataStart; // Offset of the first row, or in ASCII of the
+                          // newline before it
+    MPI_Offset rowStride; // Bytes from one row to the next
+    int        generation;// Generations run to get the board in the file
+};
+typedef struct fileLayout FileLayout;
+
+
+// Settings from the command line
+struct options {
+    char* filename;      // Name of file with matrix
+    int   numIterations; // How many generations to run
+    int   printMod;      // How frequently to print out the matrix
+    int   gridRows;      // Requested process grid, 0 x 0 lets MPI choose
+    int   gridCols;      // and 0 x 1 means one stripe of rows per process
+    int   haloDepth;     // Ghost rows kept, and generations between exchanges
+    int   serialRead;    // Read the file on one process and send out blocks
+    char* snapshot;      // Write snapshots to files starting with this
+    int   snapshotFormat;// instead of printing them, in this format
+    int   checkpointMod; // How frequently to save a checkpoint, 0 for never
+    char* checkpointFile;// File checkpoints are saved to and restarted from
+    int   restart;       // Start from the checkpoint instead of filename
+    int   torus;         // The edges of the matrix wrap around
+    int   rebalanceMod;  // How frequently to even out the rows, 0 for never
+    LifeRule rule;       // Neighbor counts that cells are born and survive
+    int   kernel;        // How cells are stepped, KERNEL_BITSLICE or LOOKUP
+    int   tiles;         // When changed tiles are tracked, one of TILES_*
+    int   periodMax;     // Longest period to stop early for, 0 for never
+    int   fastForward;   // After stopping early, skip to the last generation
+    char* statsFile;     // CSV file for population and bounds, or NULL
+    int   transport;     // How halos are exchanged, one of TRANSPORT_*
+    Dimensions generate; // Size of a random matrix to start from instead
+                         // of filename, 0 x 0 to read filename
+    double density;      // Chance of each generated cell being alive
+    uint64_t seed;       // Picks which random matrix is generated
+    char* pattern;       // RLE or plaintext pattern to start from instead
+                         // of filename, or NULL
+    Dimensions size;     // Size of the matrix the pattern is placed in, 0 x 0
+                         // for just big enough
+    int   rowOffset;     // Where the top left cell of the pattern goes
+    int   colOffset;
+    int   outputBuffers; // Snapshots that can wait to be written, 0 to
+                         // write each one before stepping on
+};
+typedef struct options Options;
+
+
+// Where my block of the matrix sits in the Cartesian process grid. Columns
+// are split on word boundaries so every block is made of whole packed words.
+//
+// Each of my rows is laid out as [guard] [west halo] [my words] [east halo]
+// [guard], with haloDepth halo rows above and below my rows. The guard
+// words are only there when the halo words get stepped too.
+struct grid {
+    MPI_Comm comm;            // Cartesian communicator over every process
+    int myRank;               // Which number process I am in comm
+    int numProcs;             // How many processes there are
+    int dims[2];              // Process rows and process columns
+    int coords[2];            // My process row and process column
+
+    int* rowBounds;           // First global row of each process row, and
+                              // the number of rows in the matrix at the end
+    int rowLow;               // First global row I own
+    int myRows;               // Number of rows I own, not counting halos
+    int wordLow;              // First global word of each row I own
+    int myWords;              // Number of words I own in each row
+
+    int haloDepth;            // Halo rows on each side
+    int firstRow;             // Index of my first row, past the north halo
+    int firstWord;            // Index of my first word, past the west halo
+    int totalRows;            // Rows in my block, halos included
+    int rowWords;             // Words in each of my rows, halos included
+
+    int neighbor[NUM_DIRS];   // Rank in each direction or MPI_PROC_NULL
+    MPI_Datatype rowType;     // haloDepth of my rows, without the halo words
+    MPI_Datatype columnType;  // One word from each of my rows
+    MPI_Datatype cornerType;  // One word from haloDepth of my rows
+    MPI_Datatype blockType;   // My rows and words without any halos
+
+    int maskWord;             // The word of each row that may hold cells past
+    uint64_t lastMask;        // the end of the matrix, and its real cells
+
+    int localWrap;            // Columns of a torus wrap around inside my rows
+    int lastBit;              // Bit of the last column in its word
+
+    int insideRows[2];        // First and last row, and first and last word,
+    int insideWords[2];       // that can be stepped without any halos
+
+    TileMap tiles;            // Parts of my block that changed recently
+    int exchanges;            // Halo exchanges so far
+    int haloChanged[NUM_DIRS];// Halo on each side may differ from last time
+
+    MPI_Request requests[2 * NUM_DIRS]; // Halo receives, then halo sends
+
+    int transport;            // How halos are exchanged, one of TRANSPORT_*
+    uint64_t** boards[2];     // The blocks the transport was opened on
+    MPI_Request persistent[2][2 * NUM_DIRS]; // Started for each of them
+    MPI_Win windows[2];       // Window over each of them
+    MPI_Group neighbors;      // Everyone I put edges to and get halos from
+    MPI_Datatype putType[NUM_DIRS]; // Where each of my edges goes in my
+    MPI_Aint putDisp[NUM_DIRS];     // neighbor's block, and the word it
+                                    // starts at
+    MPI_Comm nodeComm;        // Processes I share memory with
+    int shared[NUM_DIRS];     // Halo on that side is my neighbor's row
+};
+typedef struct grid Grid;
+
+
+// Live cells of my block, kept up to date from the tiles that change
+struct liveCount {
+    int64_t population;  // Live cells in my block
+    int64_t births;      // Cells that came to life and died in the last
+    int64_t deaths;      // generation
+    int* rows;           // Live cells in each of my rows, and in each of
+    int* words;          // my words all the way down the block
+};
+typedef struct liveCount LiveCount;
+
+
+// Where the runs of a pattern go while it is read
+struct placement {
+    Grid*      grid;      // Block of the matrix that is mine
+    uint64_t** board;     // My block with halos
+    int        rowOffset; // Where the top left cell of the pattern goes
+    int        colOffset;
+};
+typedef struct placement Placement;
+
+
+// A copy of my block, or on process 0 of the whole matrix when it is
+// printed, waiting to be written by the output thread
+struct snapshotJob {
+    uint64_t*  cells;      // Packed rows of numWords words each
+    size_t     capacity;   // Words cells has room for
+    char       filename[FILENAME_MAX]; // Snapshot file, or empty to print
+    int        format;     // SNAPSHOT_ASCII or SNAPSHOT_BINARY
+    int        generation;
+    Dimensions d;          // Rows and cols in global matrix
+    int        rowLow;     // First row and word of the matrix in cells
+    int        wordLow;
+    int        numRows;    // Rows and words in cells
+    int        numWords;
+    int        header;     // The file's header is mine to write
+    int        first;      // First matrix printed by this run, with no
+                           // blank lines before it
+};
+typedef struct snapshotJob SnapshotJob;
+
+
+// Snapshots on their way out. The main thread copies a generation into the
+// next free job and goes back to stepping while the output thread formats
+// and writes the jobs in order. When every job is still waiting to be
+// written the main thread waits too, so no snapshot is ever dropped. The
+// output thread never calls MPI.
+struct outputPipeline {
+    pthread_t       thread;   // Formats and writes the jobs
+    pthread_mutex_t lock;     // Guards everything below
+    pthread_cond_t  queued;   // A job is waiting or the pipeline closed
+    pthread_cond_t  written;  // A job has been written
+    SnapshotJob*    jobs;     // Ring of numJobs jobs
+    int             numJobs;
+    int             first;    // Oldest job still to be written
+    int             waiting;  // Jobs still to be written
+    int             closed;   // No more jobs are coming
+    int             error;    // errno of a write that failed, or 0
+    int             printed;  // Matrices queued to be printed so far
+};
+typedef struct outputPipeline OutputPipeline;
+
+
+// What the live cells of a generation look like, for my block or the whole
+// matrix. Every field is an int64_t so it goes in one MPI datatype.
+struct stats {
+    int64_t population;  // Live cells
+    int64_t births;      // Cells that came to life and died to get here
+    int64_t deaths;
+    int64_t box[4];      // Top and bottom row, then left and right column,
+                         // with a live cell. Empty is INT64_MAX and -1.
+};
+typedef struct stats Stats;
+
+#define STATS_FIELDS 7
+
+
+// Parses the command line, returning 0 or the code to exit with
+int parseOptions(int argc, char* argv[], Options* opts);
+
+
+// Reads the number of rows and columns of the matrix and shares them, along
+// with how the rows are laid out in the file
+void readMatrixDimensions(char* filename, Dimensions* dimension,
+                          FileLayout* layout, int myRank, int numProcs);
+
+
+// Lays the processes out in a grid over the matrix and finds my block. On a
+// torus the grid wraps around, so every process has all eight neighbors.
+void createGrid(Grid* grid, Dimensions d, int gridRows, int gridCols,
+                int haloDepth, int torus);
+
+
+// Frees the communicator and datatypes made by createGrid()
+void freeGrid(Grid* grid);
+
+
+// Finds my rows from the row bounds and makes the datatypes and tiles that
+// depend on how many there are. Halos start over as if never exchanged.
+void setMyRows(Grid* grid);
+
+
+// Moves the bounds between process rows so each process row should take
+// about as long to step as the others, going by how long each process spent
+// stepping since the last time. Rows only move to the next process row
+// over, and my blocks are replaced with ones the new size. Returns 1 if any
+// rows moved, and then the halos have to be exchanged again.
+int rebalanceRows(uint64_t*** matrix, uint64_t*** nextMatrix, Grid* grid,
+                  double stepTime);
+
+
+// Reads a matrix from a file and sends the blocks to coreesponding processes
+uint64_t** readBlockMatrix(
+    char*       filename,  // Name of file with matrix
+    Dimensions  d,         // Rows and cols in global matrix
+    Grid*       grid);     // Block of the matrix that is mine
+
+
+// Reads my block of the matrix straight from the file with MPI-IO, every
+// process at once. Each row is numCols characters after a newline, so where
+// my cells are can be worked out without reading anything before them.
+// Returns NULL on every process if the file is not laid out that way.
+uint64_t** readParallelMatrix(
+    char*       filename,  // Name of file with matrix
+    Dimensions  d,         // Rows and cols in global matrix
+    FileLayout* layout,    // Where the rows are in the file
+    Grid*       grid);     // Block of the matrix that is mine
+
+
+// Makes my block of a random matrix. Each cell only depends on the seed and
+// where it is, so every grid of processes makes the same matrix.
+uint64_t** generateMatrix(
+    Dimensions  d,         // Rows and cols in global matrix
+    double      density,   // Chance of each cell being alive
+    uint64_t    seed,      // Which random matrix it is
+    Grid*       grid);     // Block of the matrix that is mine
+
+
+// Next number from a splitmix64 generator
+uint64_t splitmix(uint64_t* state);
+
+
+// Finds the size of the matrix a pattern is placed in. One process reads the
+// pattern's size and checks that it fits where it goes.
+void readPatternDimensions(Options* opts, Dimensions* d, int myRank);
+
+
+// Makes my block of a matrix that is dead apart from a pattern. Every process
+// reads the whole pattern but only keeps the runs of live cells that cross
+// my block, so it takes as long as the pattern is big whatever the matrix.
+uint64_t** readPatternMatrix(
+    char*       filename,  // Name of file with the pattern
+    int         rowOffset, // Where the top left cell of the pattern goes
+    int         colOffset,
+    Grid*       grid);     // Block of the matrix that is mine
+
+
+// Sets the cells of a run from a pattern that are in my block
+void placeRun(int row, int col, int length, void* data);
+
+
+// Maps a binary board file into memory and copies my block out of it. Packed
+// rows are split on the same word boundaries as the grid, so each of my rows
+// is a single copy from the file's pages with nothing to parse.
+uint64_t** mapBoardMatrix(
+    char*       filename,  // Name of binary board file
+    Dimensions  d,         // Rows and cols in global matrix
+    FileLayout* layout,    // Where the rows are in the file
+    Grid*       grid);     // Block of the matrix that is mine
+
+
+// Finds which way a direction goes, -1, 0 or 1 rows and process columns
+void direction(int dir, int* dr, int* dc);
+
+
+// Finds the first row and word, and how many rows and words, of the edge I
+// send in a direction, or of the halo on that side of me
+void haloRect(Grid* grid, int dir, int isHalo, int rect[4]);
+
+
+// Gets the datatype for the edge sent in a direction
+MPI_Datatype haloType(Grid* grid, int dir);
+
+
+// Checks if two blocks hold the same words in a rectangle of rows and words
+int sameRect(uint64_t** a, uint64_t** b, int rect[4]);
+
+
+// Copies a rectangle of rows and words from one block to another
+void copyRect(uint64_t** to, uint64_t** from, int rect[4]);
+
+
+// Sets up grid->transport for my two blocks. The shared transport moves
+// them into memory my node can see and points my north and south halo rows
+// at my neighbors' edge rows. Every process has to call it at once.
+void openTransport(uint64_t*** matrix, uint64_t*** nextMatrix, Grid* grid);
+
+
+// Frees what openTransport() made. Blocks in shared memory are moved back
+// out with dead halos, so they can be freed or rebalanced as usual.
+void closeTransport(uint64_t*** matrix, uint64_t*** nextMatrix, Grid* grid);
+
+
+// Makes persistent sends and receives of every edge and halo of a block
+void initPersistent(uint64_t** board, Grid* grid, MPI_Request* requests);
+
+
+// Makes the datatype and offset each of my edges is put to in my
+// neighbor's block, which can be a different size from mine
+void initPuts(Grid* grid);
+
+
+// Copies a block into a window of memory shared with my node
+uint64_t** shareBoard(uint64_t** board, Grid* grid, MPI_Win* window);
+
+
+// Copies a block out of shared memory, leaving behind any halo rows that
+// belong to a neighbor, and frees the window
+uint64_t** unshareBoard(uint64_t** board, Grid* grid, MPI_Win* window);
+
+
+// Starts exchanging edges and corners with all eight neighbors so everyone
+// has what they need for the next haloDepth iterations. Nothing but the
+// halos may be written until finishHaloExchange() returns. With one halo
+// row, an edge that is the same as in the last generation is sent as an
+// empty message, and a shared halo is only told that my edge is ready.
+void startHaloExchange(uint64_t** matrix, uint64_t** nextMatrix, Grid* grid);
+
+
+// Waits for every halo to arrive and every edge to be sent. An empty halo
+// is copied over from the last generation's block.
+void finishHaloExchange(uint64_t** matrix, uint64_t** nextMatrix, Grid* grid);
+
+
+// Finds the rows and words to step while the halos are still good for depth
+// more generations: my block plus depth ghost rows, and the halo word, on
+// every side that has a neighbor
+void ghostRegion(Grid* grid, int depth, int rows[2], int words[2]);
+
+
+// Steps the inside of my block, which does not depend on any halo
+void stepInside(uint64_t** matrix, uint64_t** nextMatrix, Grid* grid);
+
+
+// Makes the tiles along every halo that changed active
+void touchEdgeTiles(Grid* grid);
+
+
+// Steps the ring between the inside of my block and its ghost region
+void stepEdges(uint64_t** matrix, uint64_t** nextMatrix, Grid* grid,
+               int depth);
+
+
+// Steps my block and its ghost region, for generations without an exchange
+void stepGhosts(uint64_t** matrix, uint64_t** nextMatrix, Grid* grid,
+                int depth);
+
+
+// Steps what is between the inner and outer rows and words, through the
+// tiles of my block or all of it
+void stepRing(uint64_t** matrix, uint64_t** nextMatrix, Grid* grid,
+              int innerRows[2], int innerWords[2], int outerRows[2],
+              int outerWords[2], int tiled);
+
+
+// On a torus that isn't split between process columns, copies the last
+// column of rows [firstRow, lastRow] into the west halo word and the first
+// column into the bit past the last column, where stepping will look for
+// them. Tiles on one edge are made active when the column on the other edge
+// changed since the last generation.
+void wrapColumns(uint64_t** matrix, uint64_t** nextMatrix, Grid* grid,
+                 int firstRow, int lastRow);
+
+
+// Clears what wrapColumns() wrote, so my rows hold nothing but cells
+void unwrapColumns(uint64_t** matrix, Grid* grid);
+
+
+// Hash of one word of cells, mixed with where it is in the matrix. Dead
+// words hash to 0.
+uint64_t hashWord(int row, int word, uint64_t cells);
+
+
+// Hash of the cells in my block. XORing the hashes of every block gives the
+// hash of the matrix, however it is split up.
+uint64_t hashBlock(uint64_t** matrix, Grid* grid);
+
+
+// What the hash of my block changed by going from lastMatrix to matrix.
+// Only the tiles that changed in that generation are looked at.
+uint64_t rehashTiles(uint64_t** matrix, uint64_t** lastMatrix, Grid* grid);
+
+
+// Counts the live cells in my block, and in each of its rows and words.
+// The counts are sized for my rows, so do it again if they change.
+void countLive(uint64_t** matrix, Grid* grid, LiveCount* live);
+
+
+// Counts the cells born and died going from lastMatrix to matrix, and keeps
+// the live counts up to date. Only the tiles that changed are looked at.
+void countChanges(uint64_t** matrix, uint64_t** lastMatrix, Grid* grid,
+                  LiveCount* live);
+
+
+// Adds up the stats of every block on process 0, which writes them out as
+// a line of the CSV file
+void reportStats(uint64_t** matrix, Grid* grid, LiveCount* live,
+                 MPI_Datatype statsType, MPI_Op statsOp, FILE* file,
+                 int generation);
+
+
+// MPI_Op for the stats of two parts of the matrix: counts add up and the
+// bounds take in both
+void combineStats(void* in, void* inout, int* len, MPI_Datatype* type);
+
+
+// Prints out a packed matrix that is rows x numCols with a halo around it
+void printSubmatrix(uint64_t** subMatrix, int rows, int numCols);
+
+
+// Gets all block information from processes and prints the matrix
+void printBlockMatrix(uint64_t** subMatrix, Dimensions d, Grid* grid);
+
+
+// Writes the matrix to a file, every process writing its own block at once.
+// An ASCII file has each of my rows formatted in a buffer first, a binary
+// file is written straight from my block and remembers the generation.
+void writeSnapshot(uint64_t** subMatrix, Dimensions d, Grid* grid,
+                   char* filename, int format, int generation);
+
+
+// Saves the matrix as a binary board file that a run can restart from. It
+// is written beside the last checkpoint and only replaces it once complete,
+// so a run that dies while saving still has the one before.
+void writeCheckpoint(uint64_t** subMatrix, Dimensions d, Grid* grid,
+                     char* filename, int generation);
+
+
+// Prints the matrix after some generation, or writes it to that
+// generation's snapshot file. With a pipeline it is only copied before
+// stepping goes on, and written while the next generations are stepped.
+void outputMatrix(uint64_t** subMatrix, Dimensions d, Grid* grid,
+                  Options* opts, OutputPipeline* pipeline, int generation);
+
+
+// Starts an output thread with room for numJobs snapshots. Returns -1 if it
+// could not be started.
+int openPipeline(OutputPipeline* pipeline, int numJobs);
+
+
+// Waits for every snapshot to be written and stops the output thread
+void closePipeline(OutputPipeline* pipeline);
+
+
+// Waits for every snapshot queued so far to be written
+void flushPipeline(OutputPipeline* pipeline);
+
+
+// Copies my block into the next free job of the pipeline and hands it to
+// the output thread, waiting for a job to be free first. Printing collects
+// the whole matrix on process 0, with filename NULL.
+void queueSnapshot(uint64_t** subMatrix, Dimensions d, Grid* grid,
+                   OutputPipeline* pipeline, char* filename, int format,
+                   int generation);
+
+
+// Waits for a job the output thread is done with. Aborts if a write has
+// failed since the last one was taken.
+SnapshotJob* takeJob(OutputPipeline* pipeline);
+
+
+// Body of the output thread, writing jobs until the pipeline is closed
+void* writeJobs(void* arg);
+
+
+// Prints the matrix in a job to stdout. Returns 0 or an errno.
+int printJob(SnapshotJob* job);
+
+
+// Writes the rows in a job to their place in its snapshot file, the same
+// file writeSnapshot() would write. Every process cuts the file to the same
+// size, so it doesn't matter who opens it first. Returns 0 or an errno.
+int writeJob(SnapshotJob* job);
+
+
+// Writes size bytes at offset of a file, however many writes it takes.
+// Returns 0 or an errno.
+int writeAt(int fd, const char* bytes, size_t size, off_t offset);
+
+
+// Gathers the seconds every process spent in each phase and has process 0
+// print the least, mean and most of them to stderr. The phases that took
+// the slowest process longest are the ones holding everyone else up.
+void reportPhases(double phaseTime[NUM_PHASES], Grid* grid, double total);
+
+int main(int argc, char* argv[]) {
+
+    double startTime; // Seconds at start of the program
+    double seqToPar;  // Seconds at end of reading matrix from file
+    double parToSeq;  // Seconds at end of loop
+    double endTime;   // Seconds at end of program
+
+    double mark;                  // Seconds at the start of the current phase
+    double phaseTime[NUM_PHASES]; // Seconds I spent in each phase
+    double maxTime[NUM_PHASES];   // The above for the slowest process
+    double lastBalance;           // Seconds spent stepping at the last
+                                  // rebalance
+
+    int myRank;       // Which number process I am [0, (n-1)]
+    int numProcs;     // How many processes there are going to be
+
+    int i;            // Used for iterating things
+    int start;        // Generation the run starts from
+    int cycleStart;   // Generation the current round of exchanges started
+    int error;        // Exit code from parsing the command line
+    int provided;     // Thread support the MPI library gave us
+    int depth;        // Generations the halos are still good for
+    int end;          // Generation the run stops at
+    int period;       // Generations the matrix repeats after, 0 if unknown
+    int p;
+
+    Options opts;     // Command line settings
+    Dimensions d;     // Dimensions of global matrix
+    FileLayout layout; // Where the rows are in the matrix file
+    Grid grid;        // My block of the matrix and who my neighbors are
+
+    uint64_t** matrix;     // My block with halos, 64 cells per word
+    uint64_t** nextMatrix; // Block the next generation is written to
+    uint64_t** swap;       // Used for trading the current and next blocks
+
+    uint64_t* history;     // Hashes of the last periodMax + 1 generations
+    uint64_t localHash;    // Hash of my block
+    uint64_t boardHash;    // Hash of the whole matrix
+
+    FILE* statsFile;           // Where process 0 writes the stats
+    LiveCount live;            // Live cells of my block
+    MPI_Datatype statsType;    // One Stats
+    MPI_Op statsOp;            // Combines the Stats of two blocks
+
+    OutputPipeline output;     // Snapshots being written while I step
+    OutputPipeline* pipeline;  // &output, or NULL to write them right away
+
+
+    // Check command line arguments
+    error = parseOptions(argc, argv, &opts);
+    if (error != 0) {
+        return error;
+    }
+
+    // Pick the kernels for the rule before any threads are started
+    setRule(&opts.rule);
+    setKernel(opts.kernel);
+    setTiles(opts.tiles);
+
+	// Begin MPI. Threads step rows but only the main thread talks to MPI.
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &numProcs);
+
+#ifdef _OPENMP
+    // Without funneled support this has to stay a single thread
+    if (provided < MPI_THREAD_FUNNELED) {
+        omp_set_num_threads(1);
+    }
+#endif
+
+    startTime = MPI_Wtime();
+    memset(phaseTime, 0, sizeof(phaseTime));
+
+
+    // A restart picks up from the last checkpoint instead of the matrix file.
+    // The checkpoint is read the same way, so it doesn't matter how many
+    // processes wrote it.
+    if (opts.restart) {
+        opts.filename = opts.checkpointFile;
+    }
+
+    // Find out how big the matrix is and split it up between processes. A
+    // generated matrix or a pattern starts from nothing.
+    mark = MPI_Wtime();
+    if (opts.filename == NULL) {
+        d = opts.generate;
+        if (opts.pattern != NULL) {
+            readPatternDimensions(&opts, &d, myRank);
+        }
+        memset(&layout, 0, sizeof(FileLayout));
+    } else {
+        readMatrixDimensions(opts.filename, &d, &layout, myRank, numProcs);
+    }
+    createGrid(&grid, d, opts.gridRows, opts.gridCols, opts.haloDepth,
+               opts.torus);
+    if (opts.transport == TRANSPORT_SHARED && grid.dims[1] != 1) {
+        if (myRank == 0) {
+            fprintf(stderr, "\nError: the shared transport needs one process "
+                            "column, not %d\n\n", grid.dims[1]);
+        }
+        MPI_Abort(MPI_COMM_WORLD, GRID_ERROR);
+    }
+    start = layout.generation;
+
+    // Read my portion of the matrix in from file, or have one process read
+    // all of it if the rows are not all the same length
+    matrix = NULL;
+    if (opts.filename == NULL && opts.pattern != NULL) {
+        matrix = readPatternMatrix(opts.pattern, opts.rowOffset,
+                                   opts.colOffset, &grid);
+    } else if (opts.filename == NULL) {
+        matrix = generateMatrix(d, opts.density, opts.seed, &grid);
+    } else if (layout.binary) {
+        matrix = mapBoardMatrix(opts.filename, d, &layout, &grid);
+    } else if (!opts.serialRead) {
+        matrix = readParallelMatrix(opts.filename, d, &layout, &grid);
+    }
+    if (matrix == NULL) {
+        matrix = readBlockMatrix(opts.filename, d, &grid);
+    }
+    phaseTime[PHASE_READ] += MPI_Wtime() - mark;
+
+
+    // Allocate a second block, halos included, to write each generation to.
+    // Its halos on the edges of the matrix have to start out dead.
+    nextMatrix = allocBoard(grid.totalRows, grid.rowWords);
+
+    // Exit if memory allocation failed
+    if (nextMatrix == NULL) {
+        MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+    }
+
+    // Set up the way halos travel between the two blocks
+    grid.transport = opts.transport;
+    openTransport(&matrix, &nextMatrix, &grid);
+
+
+    // Snapshots are written by a thread of their own
+    pipeline = NULL;
+    if (opts.outputBuffers > 0) {
+        if (openPipeline(&output, opts.outputBuffers) != 0) {
+            MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+        }
+        pipeline = &output;
+    }
+
+    // Print matrix once before modifying it
+    mark = MPI_Wtime();
+    outputMatrix(matrix, d, &grid, &opts, pipeline, start);
+
+    // Nothing before the loop may be written while it is timed
+    if (pipeline != NULL) {
+        flushPipeline(pipeline);
+    }
+    phaseTime[PHASE_OUTPUT] += MPI_Wtime() - mark;
+
+    // BEGIN parallel operations
+    seqToPar = MPI_Wtime();
+
+    lastBalance  = 0.0;
+    cycleStart   = start;
+    end          = opts.numIterations;
+    period       = 0;
+
+    // Remember the hash of every generation long enough to see it again
+    mark      = MPI_Wtime();
+    history   = NULL;
+    localHash = 0;
+    if (opts.periodMax != 0) {
+        history = (uint64_t*) malloc((opts.periodMax + 1) * sizeof(uint64_t));
+        if (history == NULL) {
+            MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+        }
+
+        localHash = hashBlock(matrix, &grid);
+        MPI_Allreduce(&localHash, &boardHash, 1, MPI_UINT64_T, MPI_BXOR,
+                      grid.comm);
+        history[start % (opts.periodMax + 1)] = boardHash;
+    }
+
+    // Count the live cells once, then keep the count up to date
+    statsFile  = NULL;
+    live.rows  = NULL;
+    live.words = NULL;
+    if (opts.statsFile != NULL) {
+        if (grid.myRank == 0) {
+            statsFile = fopen(opts.statsFile, "w");
+            if (statsFile == NULL) {
+                fprintf(stderr, "\nError: cannot open %s\n\n",
+                        opts.statsFile);
+                MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
+            }
+            fprintf(statsFile, "generation,population,births,deaths,top,"
+                               "bottom,left,right\n");
+        }
+
+        MPI_Type_contiguous(STATS_FIELDS, MPI_INT64_T, &statsType);
+        MPI_Type_commit(&statsType);
+        MPI_Op_create(combineStats, 1, &statsOp);
+
+        countLive(matrix, &grid, &live);
+        reportStats(matrix, &grid, &live, statsType, statsOp, statsFile,
+                    start);
+    }
+    phaseTime[PHASE_ANALYSIS] += MPI_Wtime() - mark;
+
+    for (i = start; i < end; ++i) {
+        // Hand rows to the processes that have been stepping faster. Their
+        // halos are gone then, so the exchanges start over. The blocks can
+        // be in either order by now, which closeTransport() sorts out.
+        if (opts.rebalanceMod != 0 && i > start
+            && (i - start) % opts.rebalanceMod == 0) {
+            mark = MPI_Wtime();
+            closeTransport(&matrix, &nextMatrix, &grid);
+            if (rebalanceRows(&matrix, &nextMatrix, &grid,
+                              phaseTime[PHASE_STEP] - lastBalance)) {
+                cycleStart = i;
+                localHash  = hashBlock(matrix, &grid);
+                if (opts.statsFile != NULL) {
+                    countLive(matrix, &grid, &live);
+                }
+            }
+            openTransport(&matrix, &nextMatrix, &grid);
+            lastBalance = phaseTime[PHASE_STEP];
+            phaseTime[PHASE_REBALANCE] += MPI_Wtime() - mark;
+        }
+
+        // Each generation uses up one ring of ghost cells
+        depth = grid.haloDepth - 1 - ((i - cycleStart) % grid.haloDepth);
+
+        // Only tiles next to a change can change
+        activateTiles(&grid.tiles);
+
+        if (depth == grid.haloDepth - 1) {
+            // Send my edges and step the inside of my block while they travel
+            mark = MPI_Wtime();
+            wrapColumns(matrix, nextMatrix, &grid, grid.firstRow,
+                        grid.firstRow + grid.myRows - 1);
+            startHaloExchange(matrix, nextMatrix, &grid);
+            phaseTime[PHASE_EXCHANGE] += MPI_Wtime() - mark;
+
+            mark = MPI_Wtime();
+            stepInside(matrix, nextMatrix, &grid);
+            phaseTime[PHASE_STEP] += MPI_Wtime() - mark;
+
+            // Finish the edges once my neighbors' edges and corners are here
+            mark = MPI_Wtime();
+            finishHaloExchange(matrix, nextMatrix, &grid);
+            wrapColumns(matrix, nextMatrix, &grid, 0, grid.firstRow - 1);
+            wrapColumns(matrix, nextMatrix, &grid,
+                        grid.firstRow + grid.myRows, grid.totalRows - 1);
+            phaseTime[PHASE_EXCHANGE] += MPI_Wtime() - mark;
+
+            mark = MPI_Wtime();
+            stepEdges(matrix, nextMatrix, &grid, depth);
+            phaseTime[PHASE_STEP] += MPI_Wtime() - mark;
+
+        } else {
+            // Recompute the ghost cells that are still good instead of
+            // asking the neighbors for them again
+            mark = MPI_Wtime();
+            wrapColumns(matrix, nextMatrix, &grid, 0, grid.totalRows - 1);
+            stepGhosts(matrix, nextMatrix, &grid, depth);
+            phaseTime[PHASE_STEP] += MPI_Wtime() - mark;
+        }
+
+        // The generation just written becomes the current one
+        swap       = matrix;
+        matrix     = nextMatrix;
+        nextMatrix = swap;
+
+        unwrapColumns(matrix, &grid);
+
+        // Count what changed while the tiles still know
+        mark = MPI_Wtime();
+        if (opts.statsFile != NULL) {
+            countChanges(matrix, nextMatrix, &grid, &live);
+            reportStats(matrix, &grid, &live, statsType, statsOp, statsFile,
+                        i + 1);
+        }
+
+        // Stop once the matrix is back to how it was a few generations ago,
+        // or skip to the generation the last one will be the same as
+        if (opts.periodMax != 0 && period == 0) {
+            localHash ^= rehashTiles(matrix, nextMatrix, &grid);
+            MPI_Allreduce(&localHash, &boardHash, 1, MPI_UINT64_T, MPI_BXOR,
+                          grid.comm);
+
+            for (p = 1; p <= opts.periodMax && p <= i + 1 - start; ++p) {
+                if (history[(i + 1 - p) % (opts.periodMax + 1)] == boardHash) {
+                    period = p;
+                    break;
+                }
+            }
+            history[(i + 1) % (opts.periodMax + 1)] = boardHash;
+
+            if (period != 0) {
+                end = i + 1;
+                if (opts.fastForward) {
+                    end += (opts.numIterations - end) % period;
+                }
+
+                if (grid.myRank == 0) {
+                    fprintf(stderr, "Generation %d is generation %d again, a "
+                                    "period of %d\n", i + 1, i + 1 - period,
+                                    period);
+                }
+            }
+        }
+        phaseTime[PHASE_ANALYSIS] += MPI_Wtime() - mark;
+
+        // Print out the matrix
+        mark = MPI_Wtime();
+        if (opts.printMod != 0 && (i % opts.printMod) == opts.printMod-1) {
+            outputMatrix(matrix, d, &grid, &opts, pipeline, i + 1);
+        }
+
+        // Save where we are in case the run dies
+        if (opts.checkpointMod != 0
+            && (i % opts.checkpointMod) == opts.checkpointMod-1) {
+            writeCheckpoint(matrix, d, &grid, opts.checkpointFile, i + 1);
+        }
+        phaseTime[PHASE_OUTPUT] += MPI_Wtime() - mark;
+    }
+
+    // END parallel operatinos
+    parToSeq = MPI_Wtime();
+
+    // Print out the resulting matrix. Fast forwarding left it the same as
+    // the last generation would have been.
+    mark = MPI_Wtime();
+    outputMatrix(matrix, d, &grid, &opts, pipeline,
+                 opts.fastForward ? opts.numIterations : end);
+
+    // Everything has to be written before the run counts as done
+    if (pipeline != NULL) {
+        closePipeline(pipeline);
+    }
+    phaseTime[PHASE_OUTPUT] += MPI_Wtime() - mark;
+
+
+    // The slowest process sets the pace for everyone
+    MPI_Reduce(phaseTime, maxTime, NUM_PHASES, MPI_DOUBLE, MPI_MAX, 0,
+               grid.comm);
+    reportPhases(phaseTime, &grid, MPI_Wtime() - startTime);
+
+
+    if (opts.statsFile != NULL) {
+        if (statsFile != NULL) {
+            fclose(statsFile);
+        }
+        MPI_Op_free(&statsOp);
+        MPI_Type_free(&statsType);
+    }
+
+    // Free dynami memory
+    free(live.rows);
+    free(live.words);
+    free(history);
+    closeTransport(&matrix, &nextMatrix, &grid);
+    freeBoard(nextMatrix);
+    freeBoard(matrix);
+
+    // Print runtimes to stderr so stdout can be piped to /dev/null. The last
+    // three are the halo depth and the seconds per generation spent
+    // exchanging halos and stepping cells.
+    endTime = MPI_Wtime();
+    if (grid.myRank == 0) {
+       fprintf(stderr, "%d,%d,%d,%d,%d,%.15f,%.15f,%.15f,%d,%.15f,%.15f\n",
+                     numProcs, d.numRows, d.numCols, opts.printMod,
+                     opts.numIterations, seqToPar-startTime,
+                     parToSeq-startTime, endTime-startTime, grid.haloDepth,
+                     maxTime[PHASE_EXCHANGE] / MAX(end - start, 1),
+                     maxTime[PHASE_STEP] / MAX(end - start, 1));
+    }
+
+    freeGrid(&grid);
+
+    MPI_Finalize();
+    return 0;
+}
+
+
+
+
+int parseOptions(int argc, char* argv[], Options* opts) {
+
+    static struct option longOptions[] = {
+        {"grid",            required_argument, NULL, 'g'},
+        {"halo-depth",      required_argument, NULL, 'k'},
+        {"serial-read",     no_argument,       NULL, 'r'},
+        {"snapshot",        required_argument, NULL, 'o'},
+        {"snapshot-format", required_argument, NULL, 'f'},
+        {"checkpoint",      required_argument, NULL, 'c'},
+        {"checkpoint-file", required_argument, NULL, 'C'},
+        {"restart",         no_argument,       NULL, 'R'},
+        {"torus",           no_argument,       NULL, 't'},
+        {"rebalance",       required_argument, NULL, 'b'},
+        {"rule",            required_argument, NULL, 'L'},
+        {"kernel",          required_argument, NULL, 'K'},
+        {"tiles",           required_argument, NULL, 'i'},
+        {"detect-period",   required_argument, NULL, 'p'},
+        {"fast-forward",    no_argument,       NULL, 'F'},
+        {"stats",           required_argument, NULL, 's'},
+        {"transport",       required_argument, NULL, 'T'},
+        {"generate",        required_argument, NULL, 'G'},
+        {"density",         required_argument, NULL, 'D'},
+        {"seed",            required_argument, NULL, 'S'},
+        {"pattern",         required_argument, NULL, 'P'},
+        {"size",            required_argument, NULL, 'z'},
+        {"at",              required_argument, NULL, 'a'},
+        {"output-buffers",  required_argument, NULL, 'O'},
+        {NULL,              0,                 NULL,  0 }
+    };
+
+    int numArgs;       // Arguments left after the options
+    int opt;
+    char* end;         // Where a number in an option stopped
+
+    // Default to one stripe of rows per process and one halo row, printing
+    // the matrix and never saving a checkpoint
+    opts->gridRows       = 0;
+    opts->gridCols       = 1;
+    opts->haloDepth      = 1;
+    opts->serialRead     = 0;
+    opts->snapshot       = NULL;
+    opts->snapshotFormat = SNAPSHOT_ASCII;
+    opts->checkpointMod  = 0;
+    opts->checkpointFile = "life.ckpt";
+    opts->restart        = 0;
+    opts->torus          = 0;
+    opts->rebalanceMod   = 0;
+    parseRule("B3/S23", &opts->rule);
+    opts->kernel         = KERNEL_BITSLICE;
+    opts->tiles          = TILES_AUTO;
+    opts->periodMax      = 0;
+    opts->fastForward    = 0;
+    opts->statsFile      = NULL;
+    opts->transport      = TRANSPORT_ISEND;
+    opts->generate.numRows = 0;
+    opts->generate.numCols = 0;
+    opts->density        = 0.5;
+    opts->seed           = 1;
+    opts->pattern        = NULL;
+    opts->size.numRows   = 0;
+    opts->size.numCols   = 0;
+    opts->rowOffset      = 0;
+    opts->colOffset      = 0;
+    opts->outputBuffers  = OUTPUT_BUFFERS;
+
+    while ((opt = getopt_long(argc, argv, "", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'g':
+                if (strcmp(optarg, "auto") == 0) {
+                    opts->gridRows = 0;
+                    opts->gridCols = 0;
+                } else if (sscanf(optarg, "%dx%d", &opts->gridRows,
+                                  &opts->gridCols) != 2
+                           || opts->gridRows <= 0 || opts->gridCols <= 0) {
+                    printf("\nError: grid must be ROWSxCOLS or auto\n\n");
+                    return 5;
+                }
+                break;
+            case 'k':
+                // Ghost columns come a word at a time, so 64 is the most
+                opts->haloDepth = atoi(optarg);
+                if (opts->haloDepth <= 0 || opts->haloDepth > CELLS_PER_WORD) {
+                    printf("\nError: halo depth must be from 1 to %d\n\n",
+                           CELLS_PER_WORD);
+                    return 6;
+                }
+                break;
+            case 'r':
+                opts->serialRead = 1;
+                break;
+            case 'o':
+                opts->snapshot = optarg;
+                break;
+            case 'f':
+                if (strcmp(optarg, "ascii") == 0) {
+                    opts->snapshotFormat = SNAPSHOT_ASCII;
+                } else if (strcmp(optarg, "binary") == 0) {
+                    opts->snapshotFormat = SNAPSHOT_BINARY;
+                } else {
+                    printf("\nError: snapshot format must be ascii or "
+                           "binary\n\n");
+                    return 7;
+                }
+                break;
+            case 'c':
+                opts->checkpointMod = atoi(optarg);
+                if (opts->checkpointMod < 0) {
+                    printf("\nError: checkpoint frequency cannot be "
+                           "negative\n\n");
+                    return 8;
+                }
+                break;
+            case 'C':
+                opts->checkpointFile = optarg;
+                break;
+            case 'R':
+                opts->restart = 1;
+                break;
+            case 't':
+                opts->torus = 1;
+                break;
+            case 'b':
+                opts->rebalanceMod = atoi(optarg);
+                if (opts->rebalanceMod < 0) {
+                    printf("\nError: rebalance frequency cannot be "
+                           "negative\n\n");
+                    return 9;
+                }
+                break;
+            case 'L':
+                if (parseRule(optarg, &opts->rule) != 0) {
+                    printf("\nError: rule must be like B3/S23, with counts "
+                           "from 0 to 8\n\n");
+                    return 10;
+                }
+                break;
+            case 'K':
+                if (strcmp(optarg, "bitslice") == 0) {
+                    opts->kernel = KERNEL_BITSLICE;
+                } else if (strcmp(optarg, "lookup") == 0) {
+                    opts->kernel = KERNEL_LOOKUP;
+                } else {
+                    printf("\nError: kernel must be bitslice or lookup\n\n");
+                    return 11;
+                }
+                break;
+            case 'i':
+                if (strcmp(optarg, "auto") == 0) {
+                    opts->tiles = TILES_AUTO;
+                } else if (strcmp(optarg, "on") == 0) {
+                    opts->tiles = TILES_ON;
+                } else if (strcmp(optarg, "off") == 0) {
+                    opts->tiles = TILES_OFF;
+                } else {
+                    printf("\nError: tiles must be auto, on or off\n\n");
+                    return 17;
+                }
+                break;
+            case 'p':
+                opts->periodMax = atoi(optarg);
+                if (opts->periodMax < 0) {
+                    printf("\nError: period cannot be negative\n\n");
+                    return 12;
+                }
+                break;
+            case 'F':
+                opts->fastForward = 1;
+                break;
+            case 's':
+                opts->statsFile = optarg;
+                break;
+            case 'T':
+                if (strcmp(optarg, "isend") == 0) {
+                    opts->transport = TRANSPORT_ISEND;
+                } else if (strcmp(optarg, "persistent") == 0) {
+                    opts->transport = TRANSPORT_PERSISTENT;
+                } else if (strcmp(optarg, "pscw") == 0) {
+                    opts->transport = TRANSPORT_PSCW;
+                } else if (strcmp(optarg, "shared") == 0) {
+                    opts->transport = TRANSPORT_SHARED;
+                } else {
+                    printf("\nError: transport must be isend, persistent, "
+                           "pscw or shared\n\n");
+                    return 13;
+                }
+                break;
+            case 'G':
+                if (sscanf(optarg, "%dx%d", &opts->generate.numRows,
+                           &opts->generate.numCols) != 2
+                    || opts->generate.numRows <= 0
+                    || opts->generate.numCols <= 0) {
+                    printf("\nError: generated matrix must be "
+                           "ROWSxCOLS\n\n");
+                    return 14;
+                }
+                break;
+            case 'D':
+                opts->density = strtod(optarg, &end);
+                if (end == optarg || *end != '\0'
+                    || !(opts->density >= 0.0 && opts->density <= 1.0)) {
+                    printf("\nError: density must be from 0 to 1\n\n");
+                    return 18;
+                }
+                break;
+            case 'S':
+                // strtoull() would quietly take a minus sign or nothing at all
+                errno = 0;
+                opts->seed = strtoull(optarg, &end, 10);
+                if (*optarg < '0' || *optarg > '9' || *end != '\0'
+                    || errno == ERANGE) {
+                    printf("\nError: seed must be a non-negative integer\n\n");
+                    return 19;
+                }
+                break;
+            case 'P':
+                opts->pattern = optarg;
+                break;
+            case 'z':
+                if (sscanf(optarg, "%dx%d", &opts->size.numRows,
+                           &opts->size.numCols) != 2
+                    || opts->size.numRows <= 0 || opts->size.numCols <= 0) {
+                    printf("\nError: matrix size must be ROWSxCOLS\n\n");
+                    return 15;
+                }
+                break;
+            case 'a':
+                if (sscanf(optarg, "%d,%d", &opts->rowOffset,
+                           &opts->colOffset) != 2
+                    || opts->rowOffset < 0 || opts->colOffset < 0) {
+                    printf("\nError: pattern must be placed at ROW,COL\n\n");
+                    return 20;
+                }
+                break;
+            case 'O':
+                opts->outputBuffers = atoi(optarg);
+                if (opts->outputBuffers < 0) {
+                    printf("\nError: output buffers cannot be negative\n\n");
+                    return 16;
+                }
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+
+    // A generated matrix or a pattern has no file, and a restart has no
+    // use for one
+    numArgs = opts->generate.numRows > 0 || opts->pattern != NULL ? 2 : 3;
+    if (opts->restart && argc - optind == 2) {
+        numArgs = 2;
+    }
+
+    if (argc - optind != numArgs) {
+        printf("\nUsage: %s [options] filename iterations printFrequency\n"
+               "  --grid ROWSxCOLS|auto  process grid, one stripe of rows "
+               "per process by default\n"
+               "  --halo-depth K         exchange K halo rows every K "
+               "generations, 1 by default\n"
+               "  --serial-read          read an ASCII file on one process "
+               "instead of with MPI-IO\n"
+               "  --snapshot PREFIX      write the matrix to PREFIX.GEN "
+               "instead of printing it\n"
+               "  --snapshot-format F    ascii, like the input, or binary\n"
+               "  --checkpoint N         save a checkpoint every N "
+               "generations\n"
+               "  --checkpoint-file F    where checkpoints go, life.ckpt "
+               "by default\n"
+               "  --restart              carry on from the checkpoint, "
+               "filename can be left\n"
+               "                         out\n"
+               "  --torus                wrap the edges of the matrix "
+               "around\n"
+               "  --rebalance N          move rows between processes every "
+               "N generations\n"
+               "                         to even out their step times\n"
+               "  --rule Bxx/Syy         counts that cells are born and "
+               "survive with, B3/S23\n"
+               "                         by default\n"
+               "  --kernel K             bitslice, adding up 64 cells at "
+               "once, or lookup,\n"
+               "                         a table of 2x2 blocks\n"
+               "  --tiles on|off|auto    skip parts of the matrix that "
+               "settled down, auto\n"
+               "                         stops looking while most of it "
+               "keeps changing\n"
+               "  --detect-period P      stop once the matrix repeats "
+               "every P or fewer\n"
+               "                         generations\n"
+               "  --fast-forward         then skip ahead to the state of "
+               "the last generation\n"
+               "  --stats FILE           write the population, births, "
+               "deaths and bounds of\n"
+               "                         the live cells every generation "
+               "to a CSV file\n"
+               "  --transport T          how halos are exchanged: isend, "
+               "persistent, pscw\n"
+               "                         or shared\n"
+               "  --generate ROWSxCOLS   start from a random matrix, "
+               "leaving out filename\n"
+               "  --density P            chance of a generated cell being "
+               "alive, 0.5 by default\n"
+               "  --seed N               which random matrix to generate, "
+               "1 by default\n"
+               "  --pattern FILE         start from an RLE or plaintext "
+               "pattern, leaving out\n"
+               "                         filename\n"
+               "  --size ROWSxCOLS       size of the matrix the pattern is "
+               "placed in, just big\n"
+               "                         enough by default\n"
+               "  --at ROW,COL           where the top left cell of the "
+               "pattern goes, 0,0 by\n"
+               "                         default\n"
+               "  --output-buffers N     snapshots that can wait to be "
+               "written while stepping\n"
+               "                         goes on, %d by default, 0 to wait "
+               "for each one\n",
+               argv[0], OUTPUT_BUFFERS);
+        return 1;
+    }
+
+    if (opts->pattern != NULL && opts->generate.numRows > 0) {
+        printf("\nError: start from a pattern or a random matrix, not "
+               "both\n\n");
+        return 21;
+    }
+
+    // Shared halo rows are whole rows of my neighbor's block, which only
+    // has them all when it is one halo row deep and never wraps columns.
+    // How many process columns there are is only known once the grid is.
+    if (opts->transport == TRANSPORT_SHARED
+        && (opts->haloDepth != 1 || opts->torus)) {
+        printf("\nError: the shared transport needs one halo row and no "
+               "torus\n\n");
+        return 22;
+    }
+
+    opts->filename = numArgs == 3 ? argv[optind] : NULL;
+
+    // Parse command line arguments
+    opts->numIterations = atoi(argv[argc - 2]);
+    if (opts->numIterations <= 0) {
+        printf("\nError: number of iterations must be a positive integer");
+        return 3;
+    }
+
+    opts->printMod = atoi(argv[argc - 1]);
+    if (opts->printMod < 0) {
+        printf("\nError: print frequency cannot be negative\n\n");
+        return 4;
+    }
+
+    return 0;
+}
+
+
+void readMatrixDimensions(char* filename, Dimensions* dimension,
+                          FileLayout* layout, int myRank, int numProcs) {
+
+    FILE* matrixFile;   // File pointer for matrix file
+    BoardHeader header; // Header of a binary board file
+    int binary;         // Which kind of file it is
+
+    // Read in matrix dimensions
+    if (myRank == (numProcs - 1)) {
+        matrixFile = fopen(filename, "r");
+
+        if (matrixFile == NULL) {
+            MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
+        }
+
+        binary = readBoardHeader(matrixFile, &header);
+
+        if (binary > 0) {
+            dimension->numRows = header.numRows;
+            dimension->numCols = header.numCols;
+
+            layout->packed     = header.packed;
+            layout->dataStart  = header.dataStart;
+            layout->rowStride  = header.rowStride;
+            layout->generation = header.generation;
+
+        } else if (binary < 0
+                   || fscanf(matrixFile, "%d %d", &dimension->numRows,
+                             &dimension->numCols) != 2) {
+
+            MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
+
+        } else {
+            // The rows start after the newline that ends the header
+            layout->packed     = 0;
+            layout->dataStart  = ftell(matrixFile);
+            layout->rowStride  = (MPI_Offset) dimension->numCols + 1;
+            layout->generation = 0;
+        }
+
+        layout->binary = binary;
+
+        fclose(matrixFile);
+    }
+
+    // Send dimensions and the layout to every process
+    MPI_Bcast(dimension, 2, MPI_INT, numProcs-1, MPI_COMM_WORLD);
+    MPI_Bcast(layout, sizeof(FileLayout), MPI_BYTE, numProcs-1,
+              MPI_COMM_WORLD);
+    if (dimension->numRows <= 0 || dimension->numCols <= 0) {
+        MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
+    }
+}
+
+
+void createGrid(Grid* grid, Dimensions d, int gridRows, int gridCols,
+                int haloDepth, int torus) {
+
+    int numWords;        // Words in a row of the global matrix
+    int periods[2];      // Process rows and columns wrap around
+    int coords[2];
+    int dir;
+    int dr;
+    int dc;
+    int p;               // Process row
+    int k = haloDepth;
+
+    MPI_Comm_size(MPI_COMM_WORLD, &grid->numProcs);
+    numWords = WORDS_FOR(d.numCols);
+
+    // Let MPI pick a balanced grid, but fall back to stripes of rows when
+    // the matrix is too narrow to give every process column a word. Torus
+    // columns only wrap between processes a whole word at a time.
+    grid->dims[0] = gridRows;
+    grid->dims[1] = gridCols;
+    MPI_Dims_create(grid->numProcs, 2, grid->dims);
+
+    if (gridRows == 0 && gridCols == 0
+        && (grid->dims[1] > numWords
+            || (torus && d.numCols % CELLS_PER_WORD != 0))) {
+        grid->dims[0] = grid->numProcs;
+        grid->dims[1] = 1;
+    }
+
+    if (grid->dims[0] * grid->dims[1] != grid->numProcs
+        || grid->dims[0] > d.numRows || grid->dims[1] > numWords) {
+
+        fprintf(stderr, "\nError: a %d x %d process grid does not fit "
+                        "a %d x %d matrix\n\n", grid->dims[0], grid->dims[1],
+                        d.numRows, d.numCols);
+        MPI_Abort(MPI_COMM_WORLD, GRID_ERROR);
+    }
+
+    if (torus && grid->dims[1] > 1 && d.numCols % CELLS_PER_WORD != 0) {
+        fprintf(stderr, "\nError: a torus can only be split between process "
+                        "columns when its width is a multiple of %d\n\n",
+                        CELLS_PER_WORD);
+        MPI_Abort(MPI_COMM_WORLD, GRID_ERROR);
+    }
+
+    // Deep halos are cut out of my neighbor's rows, so it needs enough. On
+    // a torus with one process row that neighbor is me.
+    if ((grid->dims[0] > 1 || torus) && k > d.numRows / grid->dims[0]) {
+        fprintf(stderr, "\nError: a halo depth of %d is more than the %d rows "
+                        "some processes have\n\n", k,
+                        d.numRows / grid->dims[0]);
+        MPI_Abort(MPI_COMM_WORLD, GRID_ERROR);
+    }
+
+    // A single process column wraps its own columns instead of sending
+    // itself halo words
+    periods[0] = torus;
+    periods[1] = torus && grid->dims[1] > 1;
+
+    MPI_Cart_create(MPI_COMM_WORLD, 2, grid->dims, periods, 1, &grid->comm);
+    MPI_Comm_rank(grid->comm, &grid->myRank);
+    MPI_Cart_coords(grid->comm, grid->myRank, 2, grid->coords);
+
+
+    // Split the rows evenly to start with, and find the words that are mine
+    grid->rowBounds = (int*) malloc((grid->dims[0] + 1) * sizeof(int));
+    if (grid->rowBounds == NULL) {
+        MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+    }
+
+    for (p = 0; p <= grid->dims[0]; ++p) {
+        grid->rowBounds[p] = BLOCK_LOW(p, grid->dims[0], d.numRows);
+    }
+
+    grid->wordLow = BLOCK_LOW(grid->coords[1], grid->dims[1], numWords);
+    grid->myWords = BLOCK_SIZE(grid->coords[1], grid->dims[1], numWords);
+
+    // Past one halo row the halo words get stepped too, and then they need
+    // a dead guard word beyond them to read from
+    grid->haloDepth = k;
+    grid->firstRow  = k;
+    grid->firstWord = k > 1 ? 2 : 1;
+    grid->rowWords  = grid->myWords + 2 * grid->firstWord;
+
+
+    // Look up all eight neighbors. Nobody lives past the edge of the
+    // matrix, unless the edge wraps around to the other side.
+    for (dir = 0; dir < NUM_DIRS; ++dir) {
+        direction(dir, &dr, &dc);
+
+        coords[0] = grid->coords[0] + dr;
+        coords[1] = grid->coords[1] + dc;
+
+        if ((!periods[0] && (coords[0] < 0 || coords[0] >= grid->dims[0]))
+            || (!periods[1] && (coords[1] < 0 || coords[1] >= grid->dims[1]))) {
+            grid->neighbor[dir] = MPI_PROC_NULL;
+        } else {
+            MPI_Cart_rank(grid->comm, coords, &grid->neighbor[dir]);
+        }
+    }
+
+    grid->localWrap = torus && !periods[1];
+    grid->lastBit   = (d.numCols - 1) % CELLS_PER_WORD;
+
+
+    // Only the last word of the matrix has unused bits. It is my last word
+    // in the last process column, or my east halo when my east neighbor
+    // has just that one word.
+    grid->maskWord = grid->firstWord + grid->myWords - 1;
+    grid->lastMask = ~(uint64_t) 0;
+
+    if (grid->coords[1] == grid->dims[1] - 1) {
+        grid->lastMask = lastWordMask(d.numCols);
+    } else if (grid->coords[1] == grid->dims[1] - 2
+               && BLOCK_SIZE(grid->dims[1] - 1, grid->dims[1], numWords) == 1) {
+        grid->maskWord += 1;
+        grid->lastMask = lastWordMask(d.numCols);
+    }
+
+
+    // Row halos are haloDepth whole rows, and a corner is where a row halo
+    // crosses a column halo
+    MPI_Type_vector(k, grid->myWords, grid->rowWords, MPI_UINT64_T,
+                    &grid->rowType);
+    MPI_Type_vector(k, 1, grid->rowWords, MPI_UINT64_T, &grid->cornerType);
+
+    MPI_Type_commit(&grid->rowType);
+    MPI_Type_commit(&grid->cornerType);
+
+
+    // Edge words next to a neighbor have to wait for its halo. On the edge
+    // of the matrix the halo is always dead, so they can go early.
+    grid->insideWords[0] = grid->firstWord
+                         + (grid->neighbor[WEST] == MPI_PROC_NULL ? 0 : 1);
+    grid->insideWords[1] = grid->firstWord + grid->myWords - 1
+                         - (grid->neighbor[EAST] == MPI_PROC_NULL ? 0 : 1);
+
+    // A block too thin to have an inside is all edges
+    if (grid->insideWords[1] < grid->insideWords[0] - 1) {
+        grid->insideWords[1] = grid->insideWords[0] - 1;
+    }
+
+    setMyRows(grid);
+}
+
+
+void setMyRows(Grid* grid) {
+    int dir;
+
+    grid->rowLow    = grid->rowBounds[grid->coords[0]];
+    grid->myRows    = grid->rowBounds[grid->coords[0] + 1] - grid->rowLow;
+    grid->totalRows = grid->myRows + 2 * grid->haloDepth;
+
+    // A column halo is one word out of each of my rows
+    MPI_Type_vector(grid->myRows, 1, grid->rowWords, MPI_UINT64_T,
+                    &grid->columnType);
+    MPI_Type_vector(grid->myRows, grid->myWords, grid->rowWords, MPI_UINT64_T,
+                    &grid->blockType);
+
+    MPI_Type_commit(&grid->columnType);
+    MPI_Type_commit(&grid->blockType);
+
+
+    // Edge rows next to a neighbor have to wait for its halo too
+    grid->insideRows[0]  = grid->firstRow
+                         + (grid->neighbor[NORTH] == MPI_PROC_NULL ? 0 : 1);
+    grid->insideRows[1]  = grid->firstRow + grid->myRows - 1
+                         - (grid->neighbor[SOUTH] == MPI_PROC_NULL ? 0 : 1);
+
+    if (grid->insideRows[1] < grid->insideRows[0] - 1) {
+        grid->insideRows[1] = grid->insideRows[0] - 1;
+    }
+
+
+    // Every tile of my block gets stepped in the first generation
+    if (createTiles(&grid->tiles, grid->firstRow, grid->myRows,
+                    grid->firstWord, grid->myWords) != 0) {
+        MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+    }
+
+    grid->exchanges = 0;
+    for (dir = 0; dir < NUM_DIRS; ++dir) {
+        grid->haloChanged[dir] = 0;
+    }
+}
+
+
+void freeGrid(Grid* grid) {
+    MPI_Type_free(&grid->rowType);
+    MPI_Type_free(&grid->columnType);
+    MPI_Type_free(&grid->cornerType);
+    MPI_Type_free(&grid->blockType);
+    MPI_Comm_free(&grid->comm);
+    freeTiles(&grid->tiles);
+    free(grid->rowBounds);
+}
+
+
+int rebalanceRows(uint64_t*** matrix, uint64_t*** nextMatrix, Grid* grid,
+                  double stepTime) {
+
+    double* times;        // Seconds each process spent stepping
+    double* rowTime;      // Seconds the slowest process in each row spent
+    double* speed;        // Rows stepped per second by each process row
+    double totalSpeed;    // Rows stepped per second by everyone
+    double meanTime;      // Seconds the average process row spent
+    double slowest;       // Seconds the slowest process row spent
+    double target;        // Where the next bound should be to even things out
+
+    int* bounds;          // New first row of each process row
+    int numRows;          // Rows in the matrix
+    int minRows;          // Rows a block needs to give its neighbors halos
+    int move;             // Rows a bound moves down, or up if negative
+    int moved;            // Some bound moved
+    int coords[2];
+    int p;
+    int r;
+
+    int oldLow;           // My rows before, [oldLow, oldHigh)
+    int oldHigh;
+    int newLow;           // My rows after, [newLow, newHigh)
+    int newHigh;
+    int keep[2];          // Rows that stay mine, [keep[0], keep[1])
+
+    uint64_t** block;     // My new block and the one to write next to
+    uint64_t** next;
+    MPI_Datatype moveType[2]; // Rows going to or coming from each side
+    MPI_Request requests[2];
+    int numRequests;
+
+
+    // Nothing can move without a second process row
+    if (grid->dims[0] == 1) {
+        return 0;
+    }
+
+    times   = (double*) malloc(grid->numProcs * sizeof(double));
+    rowTime = (double*) malloc(grid->dims[0] * sizeof(double));
+    speed   = (double*) malloc(grid->dims[0] * sizeof(double));
+    bounds  = (int*) malloc((grid->dims[0] + 1) * sizeof(int));
+
+    if (times == NULL || rowTime == NULL || speed == NULL || bounds == NULL) {
+        MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+    }
+
+    // A process row goes as fast as its slowest process. Everyone works
+    // the new bounds out from the same times, so they all agree.
+    MPI_Allgather(&stepTime, 1, MPI_DOUBLE, times, 1, MPI_DOUBLE, grid->comm);
+
+    for (p = 0; p < grid->dims[0]; ++p) {
+        rowTime[p] = 0.0;
+    }
+    for (r = 0; r < grid->numProcs; ++r) {
+        MPI_Cart_coords(grid->comm, r, 2, coords);
+        rowTime[coords[0]] = MAX(rowTime[coords[0]], times[r]);
+    }
+
+    meanTime   = 0.0;
+    slowest    = 0.0;
+    totalSpeed = 0.0;
+    for (p = 0; p < grid->dims[0]; ++p) {
+        meanTime += rowTime[p] / grid->dims[0];
+        slowest   = MAX(slowest, rowTime[p]);
+
+        speed[p]    = (grid->rowBounds[p+1] - grid->rowBounds[p])
+                    / MAX(rowTime[p], 1e-9);
+        totalSpeed += speed[p];
+    }
+
+    // Give each process row its share of the rows for how fast it is. A
+    // bound moves at most half of the spare rows of the block it eats into,
+    // so every block keeps enough rows and they only come from next door.
+    numRows = grid->rowBounds[grid->dims[0]];
+    minRows = grid->haloDepth;
+    target  = 0.0;
+    moved   = 0;
+
+    bounds[0] = 0;
+    bounds[grid->dims[0]] = numRows;
+
+    for (p = 1; p < grid->dims[0]; ++p) {
+        target += numRows * speed[p-1] / totalSpeed;
+        move    = (int) floor(target + 0.5) - grid->rowBounds[p];
+
+        move = MAX(move, -(grid->rowBounds[p] - grid->rowBounds[p-1]
+                           - minRows) / 2);
+        move = MIN(move, (grid->rowBounds[p+1] - grid->rowBounds[p]
+                          - minRows) / 2);
+
+        // Small differences in time are just noise
+        if (slowest <= meanTime * (1.0 + REBALANCE_SLACK)) {
+            move = 0;
+        }
+
+        bounds[p] = grid->rowBounds[p] + move;
+        moved    |= (move != 0);
+    }
+
+    free(speed);
+    free(rowTime);
+    free(times);
+
+    if (!moved) {
+        free(bounds);
+        return 0;
+    }
+
+
+    // Move my rows into a block the new size
+    oldLow  = grid->rowBounds[grid->coords[0]];
+    oldHigh = grid->rowBounds[grid->coords[0] + 1];
+    newLow  = bounds[grid->coords[0]];
+    newHigh = bounds[grid->coords[0] + 1];
+
+    free(grid->rowBounds);
+    grid->rowBounds = bounds;
+
+    MPI_Type_free(&grid->columnType);
+    MPI_Type_free(&grid->blockType);
+    freeTiles(&grid->tiles);
+    setMyRows(grid);
+
+    block = allocBoard(grid->totalRows, grid->rowWords);
+    next  = allocBoard(grid->totalRows, grid->rowWords);
+
+    // Exit if memory allocation failed
+    if (block == NULL || next == NULL) {
+        MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+    }
+
+    keep[0] = MAX(oldLow, newLow);
+    keep[1] = MIN(oldHigh, newHigh);
+
+    for (r = keep[0]; r < keep[1]; ++r) {
+        memcpy(block[grid->firstRow + r - newLow],
+               (*matrix)[grid->firstRow + r - oldLow],
+               grid->rowWords * sizeof(uint64_t));
+    }
+
+    // Rows between my old and new first row go to or come from the north,
+    // and rows between my old and new end to or from the south
+    numRequests = 0;
+
+    if (newLow != oldLow) {
+        MPI_Type_vector(abs(newLow - oldLow), grid->myWords, grid->rowWords,
+                        MPI_UINT64_T, &moveType[0]);
+        MPI_Type_commit(&moveType[0]);
+
+        if (newLow < oldLow) {
+            MPI_Irecv(&block[grid->firstRow][grid->firstWord], 1, moveType[0],
+                      grid->neighbor[NORTH], MIGRATE_MSG, grid->comm,
+                      &requests[numRequests++]);
+        } else {
+            MPI_Isend(&(*matrix)[grid->firstRow][grid->firstWord], 1,
+                      moveType[0], grid->neighbor[NORTH], MIGRATE_MSG,
+                      grid->comm, &requests[numRequests++]);
+        }
+    }
+
+    if (newHigh != oldHigh) {
+        MPI_Type_vector(abs(newHigh - oldHigh), grid->myWords, grid->rowWords,
+                        MPI_UINT64_T, &moveType[1]);
+        MPI_Type_commit(&moveType[1]);
+
+        if (newHigh > oldHigh) {
+            MPI_Irecv(&block[grid->firstRow + oldHigh - newLow]
+                            [grid->firstWord], 1, moveType[1],
+                      grid->neighbor[SOUTH], MIGRATE_MSG, grid->comm,
+                      &requests[numRequests++]);
+        } else {
+            MPI_Isend(&(*matrix)[grid->firstRow + newHigh - oldLow]
+                               [grid->firstWord], 1, moveType[1],
+                      grid->neighbor[SOUTH], MIGRATE_MSG, grid->comm,
+                      &requests[numRequests++]);
+        }
+    }
+
+    MPI_Waitall(numRequests, requests, MPI_STATUSES_IGNORE);
+
+    if (newLow != oldLow) {
+        MPI_Type_free(&moveType[0]);
+    }
+    if (newHigh != oldHigh) {
+        MPI_Type_free(&moveType[1]);
+    }
+
+    freeBoard(*matrix);
+    freeBoard(*nextMatrix);
+    *matrix     = block;
+    *nextMatrix = next;
+
+    return 1;
+}
+
+
+uint64_t** readBlockMatrix(char* filename, Dimensions d, Grid* grid) {
+
+    uint64_t** myMatrix;  // My block with halos
+    uint64_t** stripe;    // Full width rows for one process row at a time
+    int rowWords;         // Words in a full width row, including guards
+
+    FILE* matrixFile;     // File pointer for matrix file
+    char* line;           // One row of LIVE/DEAD characters from the file
+    int bytesRead;        // Used with fread to see how much data was read
+
+    int coords[2];        // Process receiving matrix data
+    int dest;
+    int size;             // How many rows a process row has
+    int words;            // How many words a process column has
+    int reader;           // Process that reads the file
+
+    MPI_Datatype stripeType; // A block cut out of the stripe
+
+    int r;
+    char junk;            // Somewhere to toss newlines
+
+    MPI_Status status;
+
+    // Allocate storage, the halos stay dead until the first exchange
+    myMatrix = allocBoard(grid->totalRows, grid->rowWords);
+
+    // Exit if memory allocation failed
+    if (myMatrix == NULL) {
+        MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+    }
+
+    reader = grid->numProcs - 1;
+
+
+    // Broadcast matrix data
+    if (grid->myRank == reader) {
+
+        rowWords = ROW_WORDS(d.numCols);
+        size     = BLOCK_SIZE(grid->dims[0] - 1, grid->dims[0], d.numRows);
+        stripe   = allocBoard(size + 2, rowWords);
+        line     = (char*) malloc(d.numCols);
+
+        matrixFile = fopen(filename, "r");
+
+        if (stripe == NULL || line == NULL) {
+            MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+        }
+
+        if (matrixFile == NULL || fscanf(matrixFile, "%*d %*d") != 0) {
+            MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
+        }
+
+        for (coords[0] = 0; coords[0] < grid->dims[0]; ++coords[0]) {
+            size = BLOCK_SIZE(coords[0], grid->dims[0], d.numRows);
+
+            // Guard words and unused bits all start out dead
+            memset(stripe[0], 0, (size + 2) * rowWords * sizeof(uint64_t));
+
+
+            // Read in rows
+            bytesRead = 0;
+            for (r = 0; r < size; ++r) {
+
+                // Remove newline character
+                if (fscanf(matrixFile, "%c", &junk) != 1) {
+                    MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
+                }
+
+                // Read row and pack it 64 cells to a word
+                bytesRead += fread(line, sizeof(char), d.numCols, matrixFile);
+                packRow(line, stripe[r+1], d.numCols);
+            }
+
+            if (bytesRead != size * d.numCols) {
+                MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
+            }
+
+
+            // Cut the stripe into blocks for each process in this row
+            for (coords[1] = 0; coords[1] < grid->dims[1]; ++coords[1]) {
+                words = BLOCK_SIZE(coords[1], grid->dims[1],
+                                   WORDS_FOR(d.numCols));
+
+                MPI_Type_vector(size, words, rowWords, MPI_UINT64_T,
+                                &stripeType);
+                MPI_Type_commit(&stripeType);
+
+                MPI_Cart_rank(grid->comm, coords, &dest);
+
+                // Guard word 0 is skipped, so global word w is at w + 1
+                r = BLOCK_LOW(coords[1], grid->dims[1],
+                              WORDS_FOR(d.numCols)) + 1;
+
+                // I don't need to send data to myself
+                if (dest != grid->myRank) {
+                    MPI_Send(stripe[1] + r, 1, stripeType, dest, DATA_MSG,
+                                grid->comm);
+                } else {
+                    MPI_Sendrecv(stripe[1] + r, 1, stripeType, dest, DATA_MSG,
+                                 &myMatrix[grid->firstRow][grid->firstWord],
+                                 1, grid->blockType, dest, DATA_MSG,
+                                 grid->comm, &status);
+                }
+
+                MPI_Type_free(&stripeType);
+            }
+        }
+
+        free(line);
+        freeBoard(stripe);
+        fclose(matrixFile);
+
+    } else {
+        // Receive matrix data
+        MPI_Recv(&myMatrix[grid->firstRow][grid->firstWord], 1,
+                    grid->blockType, reader, DATA_MSG, grid->comm, &status);
+    }
+
+    return myMatrix;
+}
+
+
+uint64_t** readParallelMatrix(char* filename, Dimensions d,
+                              FileLayout* layout, Grid* grid) {
+
+    uint64_t** myMatrix;  // My block with halos
+
+    MPI_File matrixFile;  // Matrix file, opened by every process
+    MPI_Offset fileSize;  // Bytes in the file
+    MPI_Offset offset;    // Where my first cell is in the file
+    MPI_Datatype fileType;// My part of each row in the file
+    MPI_Datatype lineType;// My part of one row in memory
+    MPI_Status status;
+
+    char* cells;          // My LIVE/DEAD characters, one line after another
+    int colLow;           // First global column I own
+    int myCols;           // Number of columns I own
+    int lineLength;       // Characters I read from each row
+    int westEdge;         // I own the first column, so I read the newlines too
+    int good;             // The file is laid out the way I expected
+    int allGood;          // It is for every process
+
+    int r;
+
+    if (MPI_File_open(grid->comm, filename, MPI_MODE_RDONLY, MPI_INFO_NULL,
+                      &matrixFile) != MPI_SUCCESS) {
+        return NULL;
+    }
+
+    // My columns, cut short where the matrix ends
+    colLow   = grid->wordLow * CELLS_PER_WORD;
+    myCols   = MIN(d.numCols - colLow, grid->myWords * CELLS_PER_WORD);
+    westEdge = (grid->coords[1] == 0);
+
+    lineLength = westEdge + myCols;
+    cells = (char*) malloc((size_t) grid->myRows * lineLength);
+    myMatrix = allocBoard(grid->totalRows, grid->rowWords);
+
+    // Exit if memory allocation failed
+    if (cells == NULL || myMatrix == NULL) {
+        MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+    }
+
+    // Every row comes after a newline, so row r starts at
+    // dataStart + 1 + r * (numCols + 1). The last row needs no newline after
+    // it, so the newline before each row is the one checked. A file too short
+    // for that is read the slow way, by everyone, since the size is the same
+    // for everyone.
+    MPI_File_get_size(matrixFile, &fileSize);
+    if (fileSize < layout->dataStart + d.numRows * layout->rowStride) {
+        free(cells);
+        freeBoard(myMatrix);
+        MPI_File_close(&matrixFile);
+        return NULL;
+    }
+
+    offset = layout->dataStart + 1 + grid->rowLow * layout->rowStride + colLow
+           - westEdge;
+
+    MPI_Type_vector(grid->myRows, lineLength, (int) layout->rowStride,
+                    MPI_CHAR, &fileType);
+    MPI_Type_commit(&fileType);
+    MPI_Type_contiguous(lineLength, MPI_CHAR, &lineType);
+    MPI_Type_commit(&lineType);
+
+    MPI_File_set_view(matrixFile, offset, MPI_CHAR, fileType, "native",
+                      MPI_INFO_NULL);
+    good = MPI_File_read_at_all(matrixFile, 0, cells, grid->myRows, lineType,
+                                &status) == MPI_SUCCESS;
+
+    // Pack each row 64 cells to a word. Column colLow goes in my first word.
+    for (r = 0; good && r < grid->myRows; ++r) {
+        if (westEdge && cells[(size_t) r * lineLength] != '\n') {
+            good = 0;
+        }
+        packRow(cells + (size_t) r * lineLength + westEdge,
+                &myMatrix[grid->firstRow + r][grid->firstWord - 1], myCols);
+    }
+
+    MPI_Type_free(&lineType);
+    MPI_Type_free(&fileType);
+    MPI_File_close(&matrixFile);
+    free(cells);
+
+    // Rows of different lengths, or a carriage return before each newline,
+    // leave the newlines somewhere else
+    MPI_Allreduce(&good, &allGood, 1, MPI_INT, MPI_MIN, grid->comm);
+    if (!allGood) {
+        freeBoard(myMatrix);
+        return NULL;
+    }
+
+    return myMatrix;
+}
+
+
+uint64_t** mapBoardMatrix(char* filename, Dimensions d, FileLayout* layout,
+                          Grid* grid) {
+
+    uint64_t** myMatrix;  // My block with halos
+    uint64_t* myRow;      // One of my rows, shifted so my first word is 1
+
+    int matrixFile;       // Binary board file
+    struct stat info;     // Used to check the file holds every row
+    off_t first;          // Where my first row is in the file
+    off_t mapStart;       // The same, rounded down to a page
+    size_t mapSize;       // Bytes mapped, up to the end of my last row
+    unsigned char* map;   // My rows of the file, mapped into memory
+    const unsigned char* row; // One of my rows in the map
+
+    int colLow;           // First global column I own
+    int myCols;           // Number of columns I own
+    int r;
+    int c;
+
+    myMatrix = allocBoard(grid->totalRows, grid->rowWords);
+
+    // Exit if memory allocation failed
+    if (myMatrix == NULL) {
+        MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+    }
+
+    matrixFile = open(filename, O_RDONLY);
+
+    // Touching a page past the end of the file would crash, so the file
+    // has to hold every row before anything is mapped
+    if (matrixFile < 0 || fstat(matrixFile, &info) != 0
+        || info.st_size < layout->dataStart
+                          + (d.numRows - 1) * layout->rowStride
+                          + boardRowBytes(d.numCols, layout->packed)) {
+        MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
+    }
+
+    // Only the pages with my rows are mapped
+    first    = layout->dataStart + (off_t) grid->rowLow * layout->rowStride;
+    mapStart = first - first % sysconf(_SC_PAGESIZE);
+    mapSize  = first - mapStart + (grid->myRows - 1) * layout->rowStride
+             + boardRowBytes(d.numCols, layout->packed);
+
+    map = mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, matrixFile, mapStart);
+    if (map == MAP_FAILED) {
+        MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
+    }
+    madvise(map, mapSize, MADV_SEQUENTIAL);
+
+    colLow = grid->wordLow * CELLS_PER_WORD;
+    myCols = MIN(d.numCols - colLow, grid->myWords * CELLS_PER_WORD);
+
+    for (r = 0; r < grid->myRows; ++r) {
+        row   = map + (first - mapStart) + r * layout->rowStride;
+        myRow = myMatrix[grid->firstRow + r] + grid->firstWord - 1;
+
+        if (layout->packed) {
+            // Bits past the last column are cleared in case the writer
+            // left anything in them
+            memcpy(myRow + 1, row + grid->wordLow * sizeof(uint64_t),
+                   grid->myWords * sizeof(uint64_t));
+            myRow[grid->myWords] &= lastWordMask(myCols);
+        } else {
+            for (c = 0; c < myCols; ++c) {
+                if (row[colLow + c]) {
+                    SET_CELL(myRow, c);
+                }
+            }
+        }
+    }
+
+    munmap(map, mapSize);
+    close(matrixFile);
+
+    return myMatrix;
+}
+
+
+uint64_t** generateMatrix(
+    Dimensions  d,         // Rows and cols in global matrix
+    double      density,   // Chance of each cell being alive
+    uint64_t    seed,      // Which random matrix it is
+    Grid*       grid) {    // Block of the matrix that is mine
+
+    uint64_t** myMatrix;   // My block with halos
+    uint64_t threshold;    // Random numbers below this are live cells
+    uint64_t state;        // Generator for the cells of one word
+    uint64_t cells;
+    int numWords;          // Words in a row of the global matrix
+    int r;
+    int w;
+    int b;
+
+    myMatrix = allocBoard(grid->totalRows, grid->rowWords);
+    if (myMatrix == NULL) {
+        MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+    }
+
+    numWords  = WORDS_FOR(d.numCols);
+
+    // A density of 1 is past the top of the generator, and converting 2^64
+    // to an integer is undefined
+    threshold = 0;
+    if (density < 1.0) {
+        threshold = (uint64_t) (density * 18446744073709551616.0);
+    }
+
+    #pragma omp parallel for schedule(static) private(w, b, state, cells)
+    for (r = 0; r < grid->myRows; ++r) {
+        for (w = 0; w < grid->myWords; ++w) {
+            state = seed ^ hashWord(grid->rowLow + r, grid->wordLow + w, 1);
+            cells = 0;
+
+            for (b = 0; b < CELLS_PER_WORD; ++b) {
+                if (density >= 1.0 || splitmix(&state) < threshold) {
+                    cells |= (uint64_t) 1 << b;
+                }
+            }
+
+            if (grid->wordLow + w == numWords - 1) {
+                cells &= lastWordMask(d.numCols);
+            }
+            myMatrix[grid->firstRow + r][grid->firstWord + w] = cells;
+        }
+    }
+
+    return myMatrix;
+}
+
+
+uint64_t splitmix(uint64_t* state) {
+    uint64_t z;
+
+    z  = (*state += 0x9e3779b97f4a7c15ULL);
+    z  = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z  = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+
+void readPatternDimensions(Options* opts, Dimensions* d, int myRank) {
+
+    FILE* patternFile; // File pointer for pattern file
+    Dimensions size;   // Rows and columns of the pattern
+
+    if (myRank == 0) {
+        patternFile = fopen(opts->pattern, "r");
+        if (patternFile == NULL) {
+            fprintf(stderr, "\nError: cannot open %s\n\n", opts->pattern);
+            MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
+        }
+
+        if (readPattern(patternFile, &size.numRows, &size.numCols, NULL,
+                        NULL) != 0) {
+            fprintf(stderr, "\nError: %s is not an RLE or plaintext "
+                            "pattern\n\n", opts->pattern);
+            MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
+        }
+        fclose(patternFile);
+
+        // Without a size the matrix ends where the pattern does
+        *d = opts->size;
+        if (d->numRows == 0) {
+            d->numRows = opts->rowOffset + size.numRows;
+            d->numCols = opts->colOffset + size.numCols;
+        }
+
+        if (size.numRows > d->numRows - opts->rowOffset
+            || size.numCols > d->numCols - opts->colOffset) {
+            fprintf(stderr, "\nError: a %d x %d pattern at %d,%d does not "
+                            "fit a %d x %d matrix\n\n", size.numRows,
+                            size.numCols, opts->rowOffset, opts->colOffset,
+                            d->numRows, d->numCols);
+            MPI_Abort(MPI_COMM_WORLD, GRID_ERROR);
+        }
+    }
+
+    MPI_Bcast(d, 2, MPI_INT, 0, MPI_COMM_WORLD);
+}
+
+
+uint64_t** readPatternMatrix(
+    char*       filename,  // Name of file with the pattern
+    int         rowOffset, // Where the top left cell of the pattern goes
+    int         colOffset,
+    Grid*       grid) {    // Block of the matrix that is mine
+
+    FILE* patternFile;     // File pointer for pattern file
+    Placement placement;   // My block and where the pattern goes in it
+    Dimensions size;       // Rows and columns of the pattern
+
+    placement.grid      = grid;
+    placement.rowOffset = rowOffset;
+    placement.colOffset = colOffset;
+    placement.board     = allocBoard(grid->totalRows, grid->rowWords);
+    if (placement.board == NULL) {
+        MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+    }
+
+    patternFile = fopen(filename, "r");
+    if (patternFile == NULL
+        || readPattern(patternFile, &size.numRows, &size.numCols, placeRun,
+                       &placement) != 0) {
+        MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
+    }
+    fclose(patternFile);
+
+    return placement.board;
+}
+
+
+void placeRun(int row, int col, int length, void* data) {
+
+    Placement* placement; // Where the pattern goes
+    Grid* grid;
+    uint64_t* myRow;      // My row the run is in
+    int first;            // First and last column of the run in my block
+    int last;
+    int c;
+
+    placement = (Placement*) data;
+    grid      = placement->grid;
+
+    row += placement->rowOffset - grid->rowLow;
+    if (row < 0 || row >= grid->myRows) {
+        return;
+    }
+
+    col  += placement->colOffset;
+    first = MAX(col, grid->wordLow * CELLS_PER_WORD);
+    last  = MIN(col + length, (grid->wordLow + grid->myWords)
+                              * CELLS_PER_WORD) - 1;
+
+    // My words start at firstWord instead of the guard word's 1
+    myRow = placement->board[grid->firstRow + row]
+            + grid->firstWord - grid->wordLow;
+    for (c = first; c <= last; ++c) {
+        myRow[c / CELLS_PER_WORD] |= CELL_BIT(c);
+    }
+}
+
+
+void direction(int dir, int* dr, int* dc) {
+    *dr = (dir == NORTH || dir == NORTH_WEST || dir == NORTH_EAST) ? -1
+        : (dir == SOUTH || dir == SOUTH_WEST || dir == SOUTH_EAST) ?  1 : 0;
+    *dc = (dir == WEST  || dir == NORTH_WEST || dir == SOUTH_WEST) ? -1
+        : (dir == EAST  || dir == NORTH_EAST || dir == SOUTH_EAST) ?  1 : 0;
+}
+
+
+void haloRect(Grid* grid, int dir, int isHalo, int rect[4]) {
+
+    int top    = grid->firstRow;                    // My first row and word
+    int left   = grid->firstWord;
+    int bottom = grid->firstRow + grid->myRows;     // The row and word past
+    int right  = grid->firstWord + grid->myWords;   // my last ones
+    int k      = grid->haloDepth;
+    int dr;
+    int dc;
+
+    direction(dir, &dr, &dc);
+
+    // Edge rows go north and south, one word of every row goes east and
+    // west, and the corners are one word from each edge row
+    rect[0] = dr < 0 ? (isHalo ? top - k : top)
+            : dr > 0 ? (isHalo ? bottom : bottom - k) : top;
+    rect[1] = dc < 0 ? (isHalo ? left - 1 : left)
+            : dc > 0 ? (isHalo ? right : right - 1) : left;
+    rect[2] = dr != 0 ? k : grid->myRows;
+    rect[3] = dc != 0 ? 1 : grid->myWords;
+}
+
+
+MPI_Datatype haloType(Grid* grid, int dir) {
+    int dr;
+    int dc;
+
+    direction(dir, &dr, &dc);
+
+    if (dr != 0 && dc != 0) {
+        return grid->cornerType;
+    }
+    return dr != 0 ? grid->rowType : grid->columnType;
+}
+
+
+int sameRect(uint64_t** a, uint64_t** b, int rect[4]) {
+    int r;
+
+    for (r = rect[0]; r < rect[0] + rect[2]; ++r) {
+        if (memcmp(a[r] + rect[1], b[r] + rect[1],
+                   rect[3] * sizeof(uint64_t)) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+void copyRect(uint64_t** to, uint64_t** from, int rect[4]) {
+    int r;
+
+    for (r = rect[0]; r < rect[0] + rect[2]; ++r) {
+        memcpy(to[r] + rect[1], from[r] + rect[1],
+               rect[3] * sizeof(uint64_t));
+    }
+}
+
+
+void openTransport(uint64_t*** matrix, uint64_t*** nextMatrix, Grid* grid) {
+
+    MPI_Group group;       // Every process in grid->comm
+    MPI_Group nodeGroup;   // The processes on my node
+    MPI_Aint size;         // Bytes in my neighbor's window
+    int ranks[NUM_DIRS];   // Each neighbor once
+    int numRanks;
+    int nodeRank;          // My neighbor's rank on my node
+    int unit;              // Bytes in each unit of my neighbor's window
+    int neighborRows;      // Rows my neighbor owns
+    int failed;            // Some process couldn't make its windows
+    int b;
+    int i;
+    int dir;
+    uint64_t* base;        // Start of my neighbor's window
+
+    grid->boards[0] = *matrix;
+    grid->boards[1] = *nextMatrix;
+
+    for (dir = 0; dir < NUM_DIRS; ++dir) {
+        grid->shared[dir] = 0;
+    }
+
+    switch (grid->transport) {
+        case TRANSPORT_PSCW:
+            // Not every MPI library can make a window over memory it didn't
+            // allocate, Open MPI with a single process for one
+            MPI_Comm_set_errhandler(grid->comm, MPI_ERRORS_RETURN);
+            failed = 0;
+            for (b = 0; b < 2; ++b) {
+                grid->windows[b] = MPI_WIN_NULL;
+                if (MPI_Win_create(grid->boards[b][0], (MPI_Aint)
+                                   grid->totalRows * grid->rowWords
+                                   * sizeof(uint64_t), sizeof(uint64_t),
+                                   MPI_INFO_NULL, grid->comm,
+                                   &grid->windows[b]) != MPI_SUCCESS) {
+                    failed = 1;
+                }
+            }
+            MPI_Comm_set_errhandler(grid->comm, MPI_ERRORS_ARE_FATAL);
+            MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_LOR,
+                          grid->comm);
+
+            // Persistent requests send the same edges the same way
+            if (failed) {
+                for (b = 0; b < 2; ++b) {
+                    if (grid->windows[b] != MPI_WIN_NULL) {
+                        MPI_Win_free(&grid->windows[b]);
+                    }
+                }
+                if (grid->myRank == 0) {
+                    fprintf(stderr, "Warning: cannot make windows over the "
+                                    "blocks, using persistent requests\n");
+                }
+
+                grid->transport = TRANSPORT_PERSISTENT;
+                initPersistent(*matrix, grid, grid->persistent[0]);
+                initPersistent(*nextMatrix, grid, grid->persistent[1]);
+                break;
+            }
+
+            // A group can't hold a process twice, and on a torus the same
+            // neighbor can be on more than one side
+            numRanks = 0;
+            for (dir = 0; dir < NUM_DIRS; ++dir) {
+                for (i = 0; i < numRanks; ++i) {
+                    if (ranks[i] == grid->neighbor[dir]) {
+                        break;
+                    }
+                }
+                if (i == numRanks && grid->neighbor[dir] != MPI_PROC_NULL) {
+                    ranks[numRanks++] = grid->neighbor[dir];
+                }
+            }
+
+            MPI_Comm_group(grid->comm, &group);
+            MPI_Group_incl(group, numRanks, ranks, &grid->neighbors);
+            MPI_Group_free(&group);
+
+            initPuts(grid);
+            break;
+
+        case TRANSPORT_PERSISTENT:
+            initPersistent(*matrix, grid, grid->persistent[0]);
+            initPersistent(*nextMatrix, grid, grid->persistent[1]);
+            break;
+
+        case TRANSPORT_SHARED:
+            MPI_Comm_split_type(grid->comm, MPI_COMM_TYPE_SHARED, 0,
+                                MPI_INFO_NULL, &grid->nodeComm);
+
+            *matrix     = shareBoard(*matrix, grid, &grid->windows[0]);
+            *nextMatrix = shareBoard(*nextMatrix, grid, &grid->windows[1]);
+            grid->boards[0] = *matrix;
+            grid->boards[1] = *nextMatrix;
+
+            MPI_Comm_group(grid->comm, &group);
+            MPI_Comm_group(grid->nodeComm, &nodeGroup);
+
+            // Everyone swaps blocks every generation, so my first block's
+            // halos are always in my neighbor's first block and the same
+            // for the second. With one process column the only neighbors
+            // are north and south.
+            for (dir = 0; dir < NUM_DIRS; ++dir) {
+                if (grid->neighbor[dir] == MPI_PROC_NULL) {
+                    continue;
+                }
+
+                MPI_Group_translate_ranks(group, 1, &grid->neighbor[dir],
+                                          nodeGroup, &nodeRank);
+                if (nodeRank == MPI_UNDEFINED) {
+                    continue;
+                }
+
+                grid->shared[dir] = 1;
+                neighborRows = dir == NORTH
+                    ? grid->rowLow - grid->rowBounds[grid->coords[0] - 1]
+                    : grid->rowBounds[grid->coords[0] + 2]
+                      - grid->rowBounds[grid->coords[0] + 1];
+
+                for (b = 0; b < 2; ++b) {
+                    MPI_Win_shared_query(grid->windows[b], nodeRank, &size,
+                                         &unit, &base);
+
+                    if (dir == NORTH) {
+                        grid->boards[b][grid->firstRow - 1] = base
+                            + (grid->firstRow + neighborRows - 1)
+                              * grid->rowWords;
+                    } else {
+                        grid->boards[b][grid->firstRow + grid->myRows] = base
+                            + grid->firstRow * grid->rowWords;
+                    }
+                }
+            }
+
+            MPI_Group_free(&nodeGroup);
+            MPI_Group_free(&group);
+            break;
+    }
+}
+
+
+void closeTransport(uint64_t*** matrix, uint64_t*** nextMatrix, Grid* grid) {
+    int dir;
+    int b;
+
+    switch (grid->transport) {
+        case TRANSPORT_PERSISTENT:
+            for (b = 0; b < 2; ++b) {
+                for (dir = 0; dir < 2 * NUM_DIRS; ++dir) {
+                    MPI_Request_free(&grid->persistent[b][dir]);
+                }
+            }
+            break;
+
+        case TRANSPORT_PSCW:
+            for (b = 0; b < 2; ++b) {
+                MPI_Win_free(&grid->windows[b]);
+            }
+            for (dir = 0; dir < NUM_DIRS; ++dir) {
+                if (grid->putType[dir] != MPI_DATATYPE_NULL) {
+                    MPI_Type_free(&grid->putType[dir]);
+                }
+            }
+            MPI_Group_free(&grid->neighbors);
+            break;
+
+        case TRANSPORT_SHARED:
+            // Nobody may still be reading my rows when they go away
+            MPI_Barrier(grid->nodeComm);
+
+            // The blocks trade places every generation, so either one can
+            // be in either window by now
+            b = *matrix == grid->boards[0] ? 0 : 1;
+            *matrix     = unshareBoard(*matrix, grid, &grid->windows[b]);
+            *nextMatrix = unshareBoard(*nextMatrix, grid,
+                                       &grid->windows[1 - b]);
+            MPI_Comm_free(&grid->nodeComm);
+            break;
+    }
+}
+
+
+void initPersistent(uint64_t** board, Grid* grid, MPI_Request* requests) {
+    int rect[4];  // Rows and words of an edge or halo
+    int dir;
+
+    for (dir = 0; dir < NUM_DIRS; ++dir) {
+        haloRect(grid, OPPOSITE(dir), 1, rect);
+        MPI_Recv_init(&board[rect[0]][rect[1]], 1, haloType(grid, dir),
+                      grid->neighbor[OPPOSITE(dir)], HALO_MSG + dir,
+                      grid->comm, &requests[dir]);
+
+        haloRect(grid, dir, 0, rect);
+        MPI_Send_init(&board[rect[0]][rect[1]], 1, haloType(grid, dir),
+                      grid->neighbor[dir], HALO_MSG + dir,
+                      grid->comm, &requests[NUM_DIRS + dir]);
+    }
+}
+
+
+void initPuts(Grid* grid) {
+
+    Grid there;        // My neighbor's block, as far as haloRect() cares
+    int* sizes;        // Rows and words each process owns
+    int mySize[2];
+    int rect[4];       // Rows and words of my neighbor's halo
+    int dir;
+
+    sizes = (int*) malloc(2 * grid->numProcs * sizeof(int));
+    if (sizes == NULL) {
+        MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+    }
+
+    mySize[0] = grid->myRows;
+    mySize[1] = grid->myWords;
+    MPI_Allgather(mySize, 2, MPI_INT, sizes, 2, MPI_INT, grid->comm);
+
+    // Every block has the same halo depth, so only its size differs
+    for (dir = 0; dir < NUM_DIRS; ++dir) {
+        grid->putType[dir] = MPI_DATATYPE_NULL;
+        grid->putDisp[dir] = 0;
+
+        if (grid->neighbor[dir] == MPI_PROC_NULL) {
+            continue;
+        }
+
+        there          = *grid;
+        there.myRows   = sizes[2 * grid->neighbor[dir]];
+        there.myWords  = sizes[2 * grid->neighbor[dir] + 1];
+        there.rowWords = there.myWords + 2 * there.firstWord;
+
+        haloRect(&there, OPPOSITE(dir), 1, rect);
+
+        MPI_Type_vector(rect[2], rect[3], there.rowWords, MPI_UINT64_T,
+                        &grid->putType[dir]);
+        MPI_Type_commit(&grid->putType[dir]);
+        grid->putDisp[dir] = (MPI_Aint) rect[0] * there.rowWords + rect[1];
+    }
+
+    free(sizes);
+}
+
+
+uint64_t** shareBoard(uint64_t** board, Grid* grid, MPI_Win* window) {
+
+    MPI_Info info;        // Lets each process's part go on its own pages
+    uint64_t* storage;    // My part of the window
+    uint64_t** shared;    // The rows of board, in storage
+    int r;
+
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "alloc_shared_noncontig", "true");
+    MPI_Win_allocate_shared((MPI_Aint) grid->totalRows * grid->rowWords
+                            * sizeof(uint64_t), sizeof(uint64_t), info,
+                            grid->nodeComm, &storage, window);
+    MPI_Info_free(&info);
+
+    shared = (uint64_t**) malloc(grid->totalRows * sizeof(uint64_t*));
+    if (shared == NULL) {
+        MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+    }
+
+    for (r = 0; r < grid->totalRows; ++r) {
+        shared[r] = storage + (size_t) r * grid->rowWords;
+        memcpy(shared[r], board[r], grid->rowWords * sizeof(uint64_t));
+    }
+    freeBoard(board);
+
+    // Only a window in an epoch can be synced with the others
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, *window);
+
+    return shared;
+}
+
+
+uint64_t** unshareBoard(uint64_t** board, Grid* grid, MPI_Win* window) {
+
+    uint64_t** copy;   // The rows of board, in memory of my own
+    int r;
+
+    copy = allocBoard(grid->totalRows, grid->rowWords);
+    if (copy == NULL) {
+        MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+    }
+
+    for (r = 0; r < grid->totalRows; ++r) {
+        if ((r == grid->firstRow - 1 && grid->shared[NORTH])
+            || (r == grid->firstRow + grid->myRows && grid->shared[SOUTH])) {
+            continue;
+        }
+        memcpy(copy[r], board[r], grid->rowWords * sizeof(uint64_t));
+    }
+
+    MPI_Win_unlock_all(*window);
+    MPI_Win_free(window);
+    free(board);
+
+    return copy;
+}
+
+
+void startHaloExchange(uint64_t** matrix, uint64_t** nextMatrix, Grid* grid) {
+
+    int rect[4];  // Rows and words of an edge or halo
+    int count;    // 1 to send an edge, 0 when it has not changed
+    int b;        // Which of the blocks the transport knows matrix is
+    int dir;
+
+    b = matrix == grid->boards[0] ? 0 : 1;
+
+    if (grid->transport == TRANSPORT_PERSISTENT) {
+        MPI_Startall(2 * NUM_DIRS, grid->persistent[b]);
+        return;
+    }
+
+    // My neighbors can put into my halos as soon as I expose them
+    if (grid->transport == TRANSPORT_PSCW) {
+        MPI_Win_post(grid->neighbors, 0, grid->windows[b]);
+        MPI_Win_start(grid->neighbors, 0, grid->windows[b]);
+
+        for (dir = 0; dir < NUM_DIRS; ++dir) {
+            if (grid->neighbor[dir] == MPI_PROC_NULL) {
+                continue;
+            }
+
+            haloRect(grid, dir, 0, rect);
+            MPI_Put(&matrix[rect[0]][rect[1]], 1, haloType(grid, dir),
+                    grid->neighbor[dir], grid->putDisp[dir], 1,
+                    grid->putType[dir], grid->windows[b]);
+        }
+        return;
+    }
+
+    // The rows I just wrote have to be seen before I say they are ready
+    if (grid->transport == TRANSPORT_SHARED) {
+        MPI_Win_sync(grid->windows[0]);
+        MPI_Win_sync(grid->windows[1]);
+    }
+
+    // Post every receive before any send so no edge has to wait on a
+    // neighbor that is still busy sending its own
+    for (dir = 0; dir < NUM_DIRS; ++dir) {
+        haloRect(grid, OPPOSITE(dir), 1, rect);
+
+        MPI_Irecv(&matrix[rect[0]][rect[1]],
+                  grid->shared[OPPOSITE(dir)] ? 0 : 1, haloType(grid, dir),
+                  grid->neighbor[OPPOSITE(dir)], HALO_MSG + dir,
+                  grid->comm, &grid->requests[dir]);
+    }
+
+    // Deeper halos are stepped between exchanges, so there is no old copy
+    // of them to fall back on
+    for (dir = 0; dir < NUM_DIRS; ++dir) {
+        haloRect(grid, dir, 0, rect);
+
+        count = 1;
+        if (grid->shared[dir]
+            || (grid->haloDepth == 1 && grid->exchanges > 0
+                && sameRect(matrix, nextMatrix, rect))) {
+            count = 0;
+        }
+
+        MPI_Isend(&matrix[rect[0]][rect[1]], count, haloType(grid, dir),
+                  grid->neighbor[dir], HALO_MSG + dir,
+                  grid->comm, &grid->requests[NUM_DIRS + dir]);
+    }
+}
+
+
+void finishHaloExchange(uint64_t** matrix, uint64_t** nextMatrix, Grid* grid) {
+
+    MPI_Status status[2 * NUM_DIRS];
+    int rect[4];  // Rows and words of a halo
+    int count;    // Edges that came in a message
+    int b;        // Which of the blocks the transport knows matrix is
+    int side;     // Side of me the halo is on
+    int dir;
+
+    b = matrix == grid->boards[0] ? 0 : 1;
+
+    switch (grid->transport) {
+        case TRANSPORT_PERSISTENT:
+            MPI_Waitall(2 * NUM_DIRS, grid->persistent[b], status);
+            break;
+
+        case TRANSPORT_PSCW:
+            MPI_Win_complete(grid->windows[b]);
+            MPI_Win_wait(grid->windows[b]);
+            break;
+
+        default:
+            MPI_Waitall(2 * NUM_DIRS, grid->requests, status);
+            break;
+    }
+
+    // My neighbors' rows are ready, now to see what they wrote
+    if (grid->transport == TRANSPORT_SHARED) {
+        MPI_Win_sync(grid->windows[0]);
+        MPI_Win_sync(grid->windows[1]);
+    }
+
+    for (dir = 0; dir < NUM_DIRS; ++dir) {
+        side = OPPOSITE(dir);
+
+        if (grid->neighbor[side] == MPI_PROC_NULL) {
+            grid->haloChanged[side] = 0;
+            continue;
+        }
+
+        // My neighbor's edge rows were not there to compare with before
+        // they were written over
+        if (grid->shared[side]) {
+            grid->haloChanged[side] = 1;
+            continue;
+        }
+
+        haloRect(grid, side, 1, rect);
+
+        // Whole edges came every time, so see if this one is any different
+        if (grid->transport == TRANSPORT_PERSISTENT
+            || grid->transport == TRANSPORT_PSCW) {
+            grid->haloChanged[side] = grid->haloDepth > 1
+                                   || grid->exchanges == 0
+                                   || !sameRect(matrix, nextMatrix, rect);
+            continue;
+        }
+
+        // My neighbor's edge is the same as the one I got last generation
+        MPI_Get_count(&status[dir], haloType(grid, dir), &count);
+        grid->haloChanged[side] = count != 0 || grid->haloDepth > 1;
+
+        if (count == 0) {
+            copyRect(matrix, nextMatrix, rect);
+        }
+    }
+
+    ++grid->exchanges;
+}
+
+
+void ghostRegion(Grid* grid, int depth, int rows[2], int words[2]) {
+
+    rows[0]  = grid->firstRow;
+    rows[1]  = grid->firstRow + grid->myRows - 1;
+    words[0] = grid->firstWord;
+    words[1] = grid->firstWord + grid->myWords - 1;
+
+    // Past the edge of the matrix the halo stays dead and is never stepped
+    if (grid->neighbor[NORTH] != MPI_PROC_NULL) {
+        rows[0] -= depth;
+    }
+    if (grid->neighbor[SOUTH] != MPI_PROC_NULL) {
+        rows[1] += depth;
+    }
+
+    // A halo word holds 64 ghost columns, so it is stepped whole. Its far
+    // side goes wrong a column a generation, which never reaches my words.
+    if (depth > 0 && grid->neighbor[WEST] != MPI_PROC_NULL) {
+        words[0] -= 1;
+    }
+    if (depth > 0 && grid->neighbor[EAST] != MPI_PROC_NULL) {
+        words[1] += 1;
+    }
+}
+
+
+void stepInside(uint64_t** matrix, uint64_t** nextMatrix, Grid* grid) {
+    stepTiles(matrix, nextMatrix, &grid->tiles, grid->insideRows[0],
+              grid->insideRows[1], grid->insideWords[0], grid->insideWords[1],
+              grid->maskWord, grid->lastMask);
+}
+
+
+void touchEdgeTiles(Grid* grid) {
+    int rect[4];  // Rows and words of my edge
+    int dir;
+
+    // Deep halos are recomputed every generation, so they always count
+    for (dir = 0; dir < NUM_DIRS; ++dir) {
+        if (grid->haloChanged[dir]) {
+            haloRect(grid, dir, 0, rect);
+            touchTiles(&grid->tiles, rect[0], rect[0] + rect[2] - 1,
+                       rect[1], rect[1] + rect[3] - 1);
+        }
+    }
+}
+
+
+void stepEdges(uint64_t** matrix, uint64_t** nextMatrix, Grid* grid,
+               int depth) {
+
+    int block[2][2];  // My rows and words
+    int ghost[2][2];  // The above plus the ghost region around them
+
+    ghostRegion(grid, 0, block[0], block[1]);
+    ghostRegion(grid, depth, ghost[0], ghost[1]);
+
+    touchEdgeTiles(grid);
+
+    stepRing(matrix, nextMatrix, grid, grid->insideRows, grid->insideWords,
+             block[0], block[1], 1);
+    stepRing(matrix, nextMatrix, grid, block[0], block[1], ghost[0], ghost[1],
+             0);
+}
+
+
+void stepGhosts(uint64_t** matrix, uint64_t** nextMatrix, Grid* grid,
+                int depth) {
+
+    int block[2][2];  // My rows and words
+    int ghost[2][2];  // The above plus the ghost region around them
+
+    ghostRegion(grid, 0, block[0], block[1]);
+    ghostRegion(grid, depth, ghost[0], ghost[1]);
+
+    touchEdgeTiles(grid);
+
+    stepTiles(matrix, nextMatrix, &grid->tiles, block[0][0], block[0][1],
+              block[1][0], block[1][1], grid->maskWord, grid->lastMask);
+    stepRing(matrix, nextMatrix, grid, block[0], block[1], ghost[0], ghost[1],
+             0);
+}
+
+
+void stepRing(uint64_t** matrix, uint64_t** nextMatrix, Grid* grid,
+              int innerRows[2], int innerWords[2], int outerRows[2],
+              int outerWords[2], int tiled) {
+
+    int part[4][4];  // Rows and words of the top, bottom, left and right
+    int p;
+
+    // Whole rows along the top and bottom
+    part[0][0] = outerRows[0];       part[0][1] = innerRows[0] - 1;
+    part[0][2] = outerWords[0];      part[0][3] = outerWords[1];
+    part[1][0] = innerRows[1] + 1;   part[1][1] = outerRows[1];
+    part[1][2] = outerWords[0];      part[1][3] = outerWords[1];
+
+    // Words down the left and right sides
+    part[2][0] = innerRows[0];       part[2][1] = innerRows[1];
+    part[2][2] = outerWords[0];      part[2][3] = innerWords[0] - 1;
+    part[3][0] = innerRows[0];       part[3][1] = innerRows[1];
+    part[3][2] = innerWords[1] + 1;  part[3][3] = outerWords[1];
+
+    for (p = 0; p < 4; ++p) {
+        if (tiled) {
+            stepTiles(matrix, nextMatrix, &grid->tiles, part[p][0],
+                      part[p][1], part[p][2], part[p][3], grid->maskWord,
+                      grid->lastMask);
+        } else {
+            stepRegion(matrix, nextMatrix, part[p][0], part[p][1],
+                       part[p][2], part[p][3], grid->maskWord,
+                       grid->lastMask);
+        }
+    }
+}
+
+
+void wrapColumns(uint64_t** matrix, uint64_t** nextMatrix, Grid* grid,
+                 int firstRow, int lastRow) {
+
+    int first = grid->firstWord; // Words with the first and last columns
+    int last  = grid->maskWord;
+    int changed[2][2];           // First and last rows where the first or
+                                 // the last column changed
+    uint64_t firstCell;          // First and last cells of a row
+    uint64_t lastCell;
+    int r;
+
+    if (!grid->localWrap) {
+        return;
+    }
+
+    changed[0][0] = changed[1][0] = lastRow + 1;
+    changed[0][1] = changed[1][1] = firstRow - 1;
+
+    for (r = firstRow; r <= lastRow; ++r) {
+        firstCell = matrix[r][first] & 1;
+        lastCell  = (matrix[r][last] >> grid->lastBit) & 1;
+
+        matrix[r][first - 1] = lastCell << (CELLS_PER_WORD - 1);
+
+        if (grid->lastBit == CELLS_PER_WORD - 1) {
+            matrix[r][last + 1] = firstCell;
+        } else {
+            matrix[r][last] |= firstCell << (grid->lastBit + 1);
+        }
+
+        // A change on one edge reaches the cells on the other
+        if (firstCell != (nextMatrix[r][first] & 1)) {
+            changed[0][0] = MIN(changed[0][0], r);
+            changed[0][1] = MAX(changed[0][1], r);
+        }
+        if (lastCell != ((nextMatrix[r][last] >> grid->lastBit) & 1)) {
+            changed[1][0] = MIN(changed[1][0], r);
+            changed[1][1] = MAX(changed[1][1], r);
+        }
+    }
+
+    if (changed[0][0] <= changed[0][1]) {
+        touchTiles(&grid->tiles, changed[0][0] - 1, changed[0][1] + 1, last,
+                   last);
+    }
+    if (changed[1][0] <= changed[1][1]) {
+        touchTiles(&grid->tiles, changed[1][0] - 1, changed[1][1] + 1, first,
+                   first);
+    }
+}
+
+
+void unwrapColumns(uint64_t** matrix, Grid* grid) {
+    int r;
+
+    if (!grid->localWrap) {
+        return;
+    }
+
+    for (r = 0; r < grid->totalRows; ++r) {
+        matrix[r][grid->firstWord - 1] = 0;
+
+        if (grid->lastBit == CELLS_PER_WORD - 1) {
+            matrix[r][grid->maskWord + 1] = 0;
+        } else {
+            matrix[r][grid->maskWord] &= grid->lastMask;
+        }
+    }
+}
+
+
+void printBlockMatrix(uint64_t** subMatrix, Dimensions d, Grid* grid) {
+
+    uint64_t** stripe;      // Full width rows for one process row at a time
+    int rowWords;           // Words in a full width row, including guards
+
+    int coords[2];          // Process whose block is being printed
+    int source;
+    int size;
+    int words;
+
+    MPI_Datatype stripeType;// Where a block goes in the stripe
+
+    MPI_Status status;
+    int prompt;
+
+
+    if (grid->myRank == 0) {
+
+        // Allocate storage for the largest process row
+        rowWords = ROW_WORDS(d.numCols);
+        size     = 0;
+        for (coords[0] = 0; coords[0] < grid->dims[0]; ++coords[0]) {
+            size = MAX(size, grid->rowBounds[coords[0] + 1]
+                             - grid->rowBounds[coords[0]]);
+        }
+        stripe   = allocBoard(size + 2, rowWords);
+
+        if (stripe == NULL) {
+            MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+        }
+
+
+        // Receive blocks from everyone and print them out a stripe at a time
+        for (coords[0] = 0; coords[0] < grid->dims[0]; ++coords[0]) {
+            size = grid->rowBounds[coords[0] + 1] - grid->rowBounds[coords[0]];
+
+            for (coords[1] = 0; coords[1] < grid->dims[1]; ++coords[1]) {
+                words = BLOCK_SIZE(coords[1], grid->dims[1],
+                                   WORDS_FOR(d.numCols));
+
+                MPI_Type_vector(size, words, rowWords, MPI_UINT64_T,
+                                &stripeType);
+                MPI_Type_commit(&stripeType);
+
+                MPI_Cart_rank(grid->comm, coords, &source);
+
+                // Guard word 0 is skipped, so global word w is at w + 1
+                words = BLOCK_LOW(coords[1], grid->dims[1],
+                                  WORDS_FOR(d.numCols)) + 1;
+
+                if (source != 0) {
+                    MPI_Send(&prompt, 1, MPI_INT, source, PROMPT_MSG,
+                                grid->comm);
+
+                    MPI_Recv(stripe[1] + words, 1, stripeType, source,
+                                RESPONSE_MSG, grid->comm, &status);
+                } else {
+                    MPI_Sendrecv(&subMatrix[grid->firstRow][grid->firstWord],
+                                 1, grid->blockType, 0, RESPONSE_MSG,
+                                 stripe[1] + words, 1, stripeType, 0,
+                                 RESPONSE_MSG, grid->comm, &status);
+                }
+
+                MPI_Type_free(&stripeType);
+            }
+
+            printSubmatrix(stripe, size + 2, d.numCols);
+        }
+
+        freeBoard(stripe);
+
+    } else {
+        // If I am not process 0, send my block to him
+        MPI_Recv(&prompt, 1, MPI_INT, 0, PROMPT_MSG, grid->comm, &status);
+        MPI_Send(&subMatrix[grid->firstRow][grid->firstWord], 1,
+                    grid->blockType, 0, RESPONSE_MSG, grid->comm);
+    }
+}
+
+
+void writeSnapshot(uint64_t** subMatrix, Dimensions d, Grid* grid,
+                   char* filename, int format, int generation) {
+
+    MPI_File snapFile;      // File the matrix is written to
+    MPI_Offset dataStart;   // Where the first row goes
+    MPI_Offset rowStride;   // Bytes from one row to the next
+    MPI_Offset offset;      // Where my first cell goes
+    MPI_Datatype fileType;  // My part of each row in the file
+    MPI_Datatype lineType;  // My part of one row in memory
+    MPI_Status status;
+
+    BoardHeader header;     // Header of a binary file
+    char text[32];          // Header of an ASCII file
+    void* headerBytes;      // Whichever header is being written
+    int headerSize;
+
+    char* cells;            // My rows as LIVE/DEAD characters
+    uint64_t* myRow;        // One of my rows, shifted so my first word is 1
+    int colLow;             // First global column I own
+    int myCols;             // Number of columns I own
+    int lineLength;         // Characters I write in each row
+    int eastEdge;           // I own the last column, so I write the newlines
+    int r;
+    int c;
+
+    if (MPI_File_open(grid->comm, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                      MPI_INFO_NULL, &snapFile) != MPI_SUCCESS) {
+        MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
+    }
+
+    if (format == SNAPSHOT_BINARY) {
+        initBoardHeader(&header, d.numRows, d.numCols, 1);
+        header.generation = generation;
+        headerBytes = &header;
+        headerSize  = sizeof(BoardHeader);
+        dataStart   = header.dataStart;
+        rowStride   = header.rowStride;
+    } else {
+        // Each row ends in a newline, the header's row too
+        headerSize  = snprintf(text, sizeof(text), "%d %d\n", d.numRows,
+                               d.numCols);
+        headerBytes = text;
+        dataStart   = headerSize;
+        rowStride   = (MPI_Offset) d.numCols + 1;
+    }
+
+    // Whatever was left from an older file is cut off
+    MPI_File_set_size(snapFile, dataStart + d.numRows * rowStride);
+
+    if (grid->myRank == 0) {
+        MPI_File_write_at(snapFile, 0, headerBytes, headerSize, MPI_BYTE,
+                          &status);
+    }
+
+    if (format == SNAPSHOT_BINARY) {
+        // Packed rows in the file are my rows without the halos and guards
+        offset = dataStart + grid->rowLow * rowStride
+               + grid->wordLow * sizeof(uint64_t);
+
+        MPI_Type_vector(grid->myRows, grid->myWords, WORDS_FOR(d.numCols),
+                        MPI_UINT64_T, &fileType);
+        MPI_Type_commit(&fileType);
+
+        MPI_File_set_view(snapFile, offset, MPI_UINT64_T, fileType, "native",
+                          MPI_INFO_NULL);
+        MPI_File_write_at_all(snapFile, 0,
+                              &subMatrix[grid->firstRow][grid->firstWord], 1,
+                              grid->blockType, &status);
+
+    } else {
+        colLow     = grid->wordLow * CELLS_PER_WORD;
+        myCols     = MIN(d.numCols - colLow, grid->myWords * CELLS_PER_WORD);
+        eastEdge   = (grid->coords[1] == grid->dims[1] - 1);
+        lineLength = myCols + eastEdge;
+
+        cells = (char*) malloc((size_t) grid->myRows * lineLength);
+
+        // Exit if memory allocation failed
+        if (cells == NULL) {
+            MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+        }
+
+        for (r = 0; r < grid->myRows; ++r) {
+            myRow = subMatrix[grid->firstRow + r] + grid->firstWord - 1;
+
+            for (c = 0; c < myCols; ++c) {
+                cells[(size_t) r * lineLength + c] =
+                    GET_CELL(myRow, c) ? LIVE : DEAD;
+            }
+
+            if (eastEdge) {
+                cells[(size_t) r * lineLength + myCols] = '\n';
+            }
+        }
+
+        offset = dataStart + grid->rowLow * rowStride + colLow;
+
+        MPI_Type_vector(grid->myRows, lineLength, (int) rowStride, MPI_CHAR,
+                        &fileType);
+        MPI_Type_commit(&fileType);
+        MPI_Type_contiguous(lineLength, MPI_CHAR, &lineType);
+        MPI_Type_commit(&lineType);
+
+        MPI_File_set_view(snapFile, offset, MPI_CHAR, fileType, "native",
+                          MPI_INFO_NULL);
+        MPI_File_write_at_all(snapFile, 0, cells, grid->myRows, lineType,
+                              &status);
+
+        MPI_Type_free(&lineType);
+        free(cells);
+    }
+
+    MPI_Type_free(&fileType);
+    MPI_File_close(&snapFile);
+}
+
+
+void writeCheckpoint(uint64_t** subMatrix, Dimensions d, Grid* grid,
+                     char* filename, int generation) {
+
+    char partial[FILENAME_MAX]; // Checkpoint while it is being written
+
+    snprintf(partial, sizeof(partial), "%s.part", filename);
+    writeSnapshot(subMatrix, d, grid, partial, SNAPSHOT_BINARY, generation);
+
+    // Every process has closed the file by now, so it is all there
+    if (grid->myRank == 0 && rename(partial, filename) != 0) {
+        MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
+    }
+}
+
+
+void outputMatrix(uint64_t** subMatrix, Dimensions d, Grid* grid,
+                  Options* opts, OutputPipeline* pipeline, int generation) {
+
+    static int printed = 0;      // Matrices printed so far by this run
+    char filename[FILENAME_MAX]; // Snapshot file for this generation
+
+    if (opts->snapshot != NULL) {
+        snprintf(filename, sizeof(filename), "%s.%d", opts->snapshot,
+                 generation);
+        if (pipeline != NULL) {
+            queueSnapshot(subMatrix, d, grid, pipeline, filename,
+                          opts->snapshotFormat, generation);
+        } else {
+            writeSnapshot(subMatrix, d, grid, filename, opts->snapshotFormat,
+                          generation);
+        }
+        return;
+    }
+
+    if (pipeline != NULL) {
+        queueSnapshot(subMatrix, d, grid, pipeline, NULL, SNAPSHOT_ASCII,
+                      generation);
+        return;
+    }
+
+    // Printed matrices after the first are set apart by blank lines, even
+    // when a restart starts past generation 0
+    if (printed++ > 0 && grid->myRank == 0) {
+        printf("\n\n");
+    }
+    printBlockMatrix(subMatrix, d, grid);
+}
+
+
+int openPipeline(OutputPipeline* pipeline, int numJobs) {
+
+    pipeline->jobs = (SnapshotJob*) calloc(numJobs, sizeof(SnapshotJob));
+    if (pipeline->jobs == NULL) {
+        return -1;
+    }
+
+    pipeline->numJobs = numJobs;
+    pipeline->first   = 0;
+    pipeline->waiting = 0;
+    pipeline->closed  = 0;
+    pipeline->error   = 0;
+    pipeline->printed = 0;
+
+    pthread_mutex_init(&pipeline->lock, NULL);
+    pthread_cond_init(&pipeline->queued, NULL);
+    pthread_cond_init(&pipeline->written, NULL);
+
+    if (pthread_create(&pipeline->thread, NULL, writeJobs, pipeline) != 0) {
+        free(pipeline->jobs);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+void flushPipeline(OutputPipeline* pipeline) {
+
+    pthread_mutex_lock(&pipeline->lock);
+    while (pipeline->waiting > 0) {
+        pthread_cond_wait(&pipeline->written, &pipeline->lock);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+
+void closePipeline(OutputPipeline* pipeline) {
+    int j;
+
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->closed = 1;
+    pthread_cond_signal(&pipeline->queued);
+    pthread_mutex_unlock(&pipeline->lock);
+
+    pthread_join(pipeline->thread, NULL);
+
+    if (pipeline->error != 0) {
+        fprintf(stderr, "\nError: cannot write a snapshot: %s\n\n",
+                strerror(pipeline->error));
+        MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
+    }
+
+    for (j = 0; j < pipeline->numJobs; ++j) {
+        free(pipeline->jobs[j].cells);
+    }
+    free(pipeline->jobs);
+
+    pthread_cond_destroy(&pipeline->written);
+    pthread_cond_destroy(&pipeline->queued);
+    pthread_mutex_destroy(&pipeline->lock);
+}
+
+
+void queueSnapshot(uint64_t** subMatrix, Dimensions d, Grid* grid,
+                   OutputPipeline* pipeline, char* filename, int format,
+                   int generation) {
+
+    SnapshotJob* job;       // Where the copy goes
+    size_t size;            // Words the copy takes up
+    uint64_t* start;        // Where a block starts in the copy
+
+    int coords[2];          // Process whose block is being collected
+    int source;
+    int rows;
+    int words;
+    int r;
+
+    MPI_Datatype blockType; // Where a block goes in the copy
+    MPI_Status status;
+
+    // Only process 0 prints, everyone else just sends it their block
+    if (filename == NULL && grid->myRank != 0) {
+        MPI_Send(&subMatrix[grid->firstRow][grid->firstWord], 1,
+                 grid->blockType, 0, RESPONSE_MSG, grid->comm);
+        return;
+    }
+
+    job = takeJob(pipeline);
+
+    job->format     = format;
+    job->generation = generation;
+    job->d          = d;
+    job->header     = (grid->myRank == 0);
+
+    if (filename == NULL) {
+        job->filename[0] = '\0';
+        job->first       = (pipeline->printed++ == 0);
+        job->rowLow      = 0;
+        job->wordLow     = 0;
+        job->numRows     = d.numRows;
+        job->numWords    = WORDS_FOR(d.numCols);
+    } else {
+        snprintf(job->filename, sizeof(job->filename), "%s", filename);
+        job->rowLow      = grid->rowLow;
+        job->wordLow     = grid->wordLow;
+        job->numRows     = grid->myRows;
+        job->numWords    = grid->myWords;
+    }
+
+    // Rebalancing can make my block bigger than the last time the job was
+    // used
+    size = (size_t) job->numRows * job->numWords;
+    if (size > job->capacity) {
+        free(job->cells);
+        job->cells = (uint64_t*) malloc(size * sizeof(uint64_t));
+        if (job->cells == NULL) {
+            MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+        }
+        job->capacity = size;
+    }
+
+    start = job->cells
+          + (size_t) (grid->rowLow - job->rowLow) * job->numWords
+          + grid->wordLow - job->wordLow;
+    for (r = 0; r < grid->myRows; ++r) {
+        memcpy(start + (size_t) r * job->numWords,
+               &subMatrix[grid->firstRow + r][grid->firstWord],
+               grid->myWords * sizeof(uint64_t));
+    }
+
+    // The rest of a printed matrix comes from everyone else
+    if (filename == NULL) {
+        for (source = 1; source < grid->numProcs; ++source) {
+            MPI_Cart_coords(grid->comm, source, 2, coords);
+
+            rows  = grid->rowBounds[coords[0] + 1]
+                  - grid->rowBounds[coords[0]];
+            words = BLOCK_SIZE(coords[1], grid->dims[1], job->numWords);
+            start = job->cells
+                  + (size_t) grid->rowBounds[coords[0]] * job->numWords
+                  + BLOCK_LOW(coords[1], grid->dims[1], job->numWords);
+
+            MPI_Type_vector(rows, words, job->numWords, MPI_UINT64_T,
+                            &blockType);
+            MPI_Type_commit(&blockType);
+            MPI_Recv(start, 1, blockType, source, RESPONSE_MSG, grid->comm,
+                     &status);
+            MPI_Type_free(&blockType);
+        }
+    }
+
+    pthread_mutex_lock(&pipeline->lock);
+    ++pipeline->waiting;
+    pthread_cond_signal(&pipeline->queued);
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+
+SnapshotJob* takeJob(OutputPipeline* pipeline) {
+
+    SnapshotJob* job;       // The job after the last one waiting
+    int error;              // Why the last write failed, or 0
+
+    pthread_mutex_lock(&pipeline->lock);
+    while (pipeline->waiting == pipeline->numJobs) {
+        pthread_cond_wait(&pipeline->written, &pipeline->lock);
+    }
+    job   = &pipeline->jobs[(pipeline->first + pipeline->waiting)
+                            % pipeline->numJobs];
+    error = pipeline->error;
+    pthread_mutex_unlock(&pipeline->lock);
+
+    if (error != 0) {
+        fprintf(stderr, "\nError: cannot write a snapshot: %s\n\n",
+                strerror(error));
+        MPI_Abort(MPI_COMM_WORLD, OPEN_FILE_ERROR);
+    }
+
+    return job;
+}
+
+
+void* writeJobs(void* arg) {
+
+    OutputPipeline* pipeline; // Pipeline I write the jobs of
+    SnapshotJob* job;
+    int error;
+
+    pipeline = (OutputPipeline*) arg;
+
+    pthread_mutex_lock(&pipeline->lock);
+    for (;;) {
+        while (pipeline->waiting == 0 && !pipeline->closed) {
+            pthread_cond_wait(&pipeline->queued, &pipeline->lock);
+        }
+        if (pipeline->waiting == 0) {
+            break;
+        }
+
+        // The main thread leaves the job alone until it is written
+        job = &pipeline->jobs[pipeline->first];
+        pthread_mutex_unlock(&pipeline->lock);
+
+        error = job->filename[0] == '\0' ? printJob(job) : writeJob(job);
+
+        pthread_mutex_lock(&pipeline->lock);
+        if (pipeline->error == 0) {
+            pipeline->error = error;
+        }
+        pipeline->first = (pipeline->first + 1) % pipeline->numJobs;
+        --pipeline->waiting;
+        pthread_cond_signal(&pipeline->written);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+
+    return NULL;
+}
+
+
+int printJob(SnapshotJob* job) {
+
+    char* line;             // One row of the matrix as it is printed
+    uint64_t* row;
+    int r;
+    int c;
+
+    line = (char*) malloc(job->d.numCols + 1);
+    if (line == NULL) {
+        return ENOMEM;
+    }
+
+    // Printed matrices after the first are set apart by blank lines
+    if (!job->first) {
+        fputs("\n\n", stdout);
+    }
+
+    line[job->d.numCols] = '\n';
+    for (r = 0; r < job->numRows; ++r) {
+        row = job->cells + (size_t) r * job->numWords;
+        for (c = 0; c < job->d.numCols; ++c) {
+            line[c] = (row[c / CELLS_PER_WORD] & CELL_BIT(c)) ? '+' : ' ';
+        }
+        fwrite(line, 1, job->d.numCols + 1, stdout);
+    }
+
+    free(line);
+    return ferror(stdout) ? EIO : 0;
+}
+
+
+int writeJob(SnapshotJob* job) {
+
+    BoardHeader header;     // Header of a binary file
+    char text[32];          // Header of an ASCII file
+    char* headerBytes;      // Whichever header is being written
+    size_t headerSize;
+
+    off_t dataStart;        // Where the first row goes
+    off_t rowStride;        // Bytes from one row to the next
+    off_t offset;           // Where my first cell goes
+
+    char* bytes;            // My rows as they go in the file
+    uint64_t* row;
+    size_t lineLength;      // Bytes I write in each row
+    int colLow;             // First global column in the job
+    int myCols;             // Number of columns in the job
+    int eastEdge;           // The job has the last column, so the newlines
+    int fd;
+    int error;
+    int r;
+    int c;
+
+    if (job->format == SNAPSHOT_BINARY) {
+        initBoardHeader(&header, job->d.numRows, job->d.numCols, 1);
+        header.generation = job->generation;
+        headerBytes = (char*) &header;
+        headerSize  = sizeof(BoardHeader);
+        dataStart   = header.dataStart;
+        rowStride   = header.rowStride;
+
+        // Packed rows in the file are the rows of the job as they are
+        bytes      = (char*) job->cells;
+        lineLength = job->numWords * sizeof(uint64_t);
+        offset     = dataStart + (off_t) job->rowLow * rowStride
+                   + job->wordLow * sizeof(uint64_t);
+
+    } else {
+        // Each row ends in a newline, the header's row too
+        headerSize  = snprintf(text, sizeof(text), "%d %d\n", job->d.numRows,
+                               job->d.numCols);
+        headerBytes = text;
+        dataStart   = headerSize;
+        rowStride   = (off_t) job->d.numCols + 1;
+
+        colLow     = job->wordLow * CELLS_PER_WORD;
+        myCols     = MIN(job->d.numCols - colLow,
+                         job->numWords * CELLS_PER_WORD);
+        eastEdge   = (job->wordLow + job->numWords
+                      == WORDS_FOR(job->d.numCols));
+        lineLength = myCols + eastEdge;
+
+        bytes = (char*) malloc((size_t) job->numRows * lineLength);
+        if (bytes == NULL) {
+            return ENOMEM;
+        }
+
+        for (r = 0; r < job->numRows; ++r) {
+            row = job->cells + (size_t) r * job->numWords;
+            for (c = 0; c < myCols; ++c) {
+                bytes[(size_t) r * lineLength + c] =
+                    (row[c / CELLS_PER_WORD] & CELL_BIT(c)) ? LIVE : DEAD;
+            }
+
+            if (eastEdge) {
+                bytes[(size_t) r * lineLength + myCols] = '\n';
+            }
+        }
+
+        offset = dataStart + (off_t) job->rowLow * rowStride + colLow;
+    }
+
+    error = 0;
+    fd    = open(job->filename, O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+        error = errno;
+    }
+
+    // Whatever was left from an older file is cut off
+    if (error == 0
+        && ftruncate(fd, dataStart + job->d.numRows * rowStride) != 0) {
+        error = errno;
+    }
+
+    if (error == 0 && job->header) {
+        error = writeAt(fd, headerBytes, headerSize, 0);
+    }
+
+    // Rows that are next to each other in the file go out in one write
+    if (error == 0 && (off_t) lineLength == rowStride) {
+        error = writeAt(fd, bytes, job->numRows * lineLength, offset);
+    }
+    for (r = 0; error == 0 && (off_t) lineLength != rowStride
+                && r < job->numRows; ++r) {
+        error = writeAt(fd, bytes + (size_t) r * lineLength, lineLength,
+                        offset + r * rowStride);
+    }
+
+    if (fd >= 0 && close(fd) != 0 && error == 0) {
+        error = errno;
+    }
+    if (job->format != SNAPSHOT_BINARY) {
+        free(bytes);
+    }
+
+    return error;
+}
+
+
+int writeAt(int fd, const char* bytes, size_t size, off_t offset) {
+    ssize_t written;
+
+    while (size > 0) {
+        written = pwrite(fd, bytes, size, offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+
+        bytes  += written;
+        size   -= written;
+        offset += written;
+    }
+
+    return 0;
+}
+
+
+void reportPhases(double phaseTime[NUM_PHASES], Grid* grid, double total) {
+
+    static const char* names[NUM_PHASES] = {
+        "read", "exchange", "step", "rebalance", "analysis", "output"
+    };
+
+    double* all;       // Seconds in each phase of every process, by rank
+    double least;      // Seconds of the fastest process in a phase
+    double most;       // Seconds of the slowest process in a phase
+    double sum;        // Seconds of every process in a phase added up
+    double busy;       // Seconds a process spent in all of the phases
+    double longest;    // The above for the busiest process
+    double wall;       // Seconds the slowest process has been running
+    int    slowest;    // Rank of the slowest process in a phase
+    int    critical;   // Rank of the busiest process
+    int    n;
+    int    r;
+
+    // Only process 0 needs room for everyone's
+    all = NULL;
+    if (grid->myRank == 0) {
+        all = (double*) malloc(grid->numProcs * NUM_PHASES * sizeof(double));
+        if (all == NULL) {
+            MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+        }
+    }
+
+    MPI_Gather(phaseTime, NUM_PHASES, MPI_DOUBLE, all, NUM_PHASES, MPI_DOUBLE,
+               0, grid->comm);
+
+    // Nobody can be busy for longer than the slowest of us has been running
+    MPI_Reduce(&total, &wall, 1, MPI_DOUBLE, MPI_MAX, 0, grid->comm);
+
+    if (grid->myRank != 0) {
+        return;
+    }
+
+    fprintf(stderr, "%-10s %12s %12s %12s %8s %9s\n", "phase", "min",
+            "mean", "max", "slowest", "max/mean");
+
+    for (n = 0; n < NUM_PHASES; ++n) {
+        least   = all[n];
+        most    = all[n];
+        sum     = 0.0;
+        slowest = 0;
+        for (r = 0; r < grid->numProcs; ++r) {
+            sum  += all[r * NUM_PHASES + n];
+            least = MIN(least, all[r * NUM_PHASES + n]);
+            if (all[r * NUM_PHASES + n] > most) {
+                most    = all[r * NUM_PHASES + n];
+                slowest = r;
+            }
+        }
+
+        fprintf(stderr, "%-10s %12.6f %12.6f %12.6f %8d %9.3f\n", names[n],
+                least, sum / grid->numProcs, most, slowest,
+                sum > 0.0 ? most * grid->numProcs / sum : 1.0);
+    }
+
+    // Everyone waits on the busiest process, so where its time went is
+    // where the run's time went
+    longest  = -1.0;
+    critical = 0;
+    for (r = 0; r < grid->numProcs; ++r) {
+        busy = 0.0;
+        for (n = 0; n < NUM_PHASES; ++n) {
+            busy += all[r * NUM_PHASES + n];
+        }
+        if (busy > longest) {
+            longest  = busy;
+            critical = r;
+        }
+    }
+
+    fprintf(stderr, "Critical path: process %d busy %.6f of %.6f seconds,",
+            critical, longest, wall);
+    for (n = 0; n < NUM_PHASES; ++n) {
+        fprintf(stderr, " %s %.1f%%", names[n],
+                longest > 0.0 ? 100.0 * all[critical * NUM_PHASES + n]
+                                / longest : 0.0);
+    }
+    fprintf(stderr, "\n");
+
+    free(all);
+}
+
+
+void printSubmatrix(uint64_t** subMatrix, int rows, int numCols) {
+    int r;
+    int c;
+
+    for (r = 1; r < rows - 1; ++r) {
+        for (c = 0; c < numCols; ++c) {
+            printf("%c", GET_CELL(subMatrix[r], c) ? '+' : ' ');
+       }
+       printf("\n");
+    }
+}
+
+
+uint64_t hashWord(int row, int word, uint64_t cells) {
+    uint64_t h;
+
+    if (cells == 0) {
+        return 0;
+    }
+
+    // The finisher of splitmix64, so a flipped bit changes half the hash
+    h  = cells ^ (((uint64_t) row << 32 | (uint32_t) word)
+                  * 0x9e3779b97f4a7c15ULL);
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+
+    return h;
+}
+
+
+uint64_t hashBlock(uint64_t** matrix, Grid* grid) {
+    uint64_t hash = 0;
+    uint64_t cells;
+    int r;
+    int w;
+
+    for (r = grid->firstRow; r < grid->firstRow + grid->myRows; ++r) {
+        for (w = grid->firstWord; w < grid->firstWord + grid->myWords; ++w) {
+            cells = matrix[r][w];
+            if (w == grid->maskWord) {
+                cells &= grid->lastMask;
+            }
+
+            hash ^= hashWord(grid->rowLow + r - grid->firstRow,
+                             grid->wordLow + w - grid->firstWord, cells);
+        }
+    }
+
+    return hash;
+}
+
+
+uint64_t rehashTiles(uint64_t** matrix, uint64_t** lastMatrix, Grid* grid) {
+    TileMap* tiles = &grid->tiles;
+    uint64_t change = 0;  // Hashes of the words that changed, old and new
+    uint64_t cells[2];    // A word in this generation and the last one
+    int tr;
+    int tc;
+    int r;
+    int w;
+
+    for (tr = 0; tr < tiles->tileRows; ++tr) {
+        for (tc = 0; tc < tiles->tileCols; ++tc) {
+            if (!tiles->changed[tr * tiles->tileCols + tc]) {
+                continue;
+            }
+
+            for (r = tiles->firstRow + tr * TILE_ROWS;
+                 r < tiles->firstRow + MIN((tr + 1) * TILE_ROWS,
+                                           tiles->numRows); ++r) {
+                for (w = tiles->firstWord + tc * TILE_WORDS;
+                     w < tiles->firstWord + MIN((tc + 1) * TILE_WORDS,
+                                                tiles->numWords); ++w) {
+
+                    // Torus columns can still be wrapped into the last one
+                    cells[0] = matrix[r][w];
+                    cells[1] = lastMatrix[r][w];
+                    if (w == grid->maskWord) {
+                        cells[0] &= grid->lastMask;
+                        cells[1] &= grid->lastMask;
+                    }
+
+                    if (cells[0] != cells[1]) {
+                        change ^= hashWord(grid->rowLow + r - grid->firstRow,
+                                           grid->wordLow + w
+                                           - grid->firstWord, cells[0])
+                                ^ hashWord(grid->rowLow + r - grid->firstRow,
+                                           grid->wordLow + w
+                                           - grid->firstWord, cells[1]);
+                    }
+                }
+            }
+        }
+    }
+
+    return change;
+}
+
+
+void countLive(uint64_t** matrix, Grid* grid, LiveCount* live) {
+    uint64_t cells;
+    int r;
+    int w;
+
+    free(live->rows);
+    free(live->words);
+    live->rows  = (int*) calloc(grid->myRows, sizeof(int));
+    live->words = (int*) calloc(grid->myWords, sizeof(int));
+
+    if (live->rows == NULL || live->words == NULL) {
+        MPI_Abort(MPI_COMM_WORLD, MALLOC_ERROR);
+    }
+
+    live->population = 0;
+    live->births     = 0;
+    live->deaths     = 0;
+
+    for (r = 0; r < grid->myRows; ++r) {
+        for (w = 0; w < grid->myWords; ++w) {
+            cells = matrix[grid->firstRow + r][grid->firstWord + w];
+            if (grid->firstWord + w == grid->maskWord) {
+                cells &= grid->lastMask;
+            }
+
+            live->rows[r]     += __builtin_popcountll(cells);
+            live->words[w]    += __builtin_popcountll(cells);
+            live->population  += __builtin_popcountll(cells);
+        }
+    }
+}
+
+
+void countChanges(uint64_t** matrix, uint64_t** lastMatrix, Grid* grid,
+                  LiveCount* live) {
+
+    TileMap* tiles = &grid->tiles;
+    unsigned char* changed;  // Flags for this row of tiles
+    uint64_t cells[2];       // A word in this generation and the last one
+    int born;                // Cells of the word that came to life and died
+    int died;
+    int rowChange;           // Live cells my row gained
+    int64_t births = 0;      // Cells of my block that came to life and died
+    int64_t deaths = 0;
+    int tr;
+    int tc;
+    int r;
+    int w;
+    int w1;                  // Last word of a run of changed tiles
+
+    // Go along whole rows of the changed tiles so the words come in order
+    for (tr = 0; tr < tiles->tileRows; ++tr) {
+        changed = tiles->changed + tr * tiles->tileCols;
+
+        for (r = tiles->firstRow + tr * TILE_ROWS;
+             r < tiles->firstRow + MIN((tr + 1) * TILE_ROWS, tiles->numRows);
+             ++r) {
+
+            rowChange = 0;
+
+            for (tc = 0; tc < tiles->tileCols; ++tc) {
+                if (!changed[tc]) {
+                    continue;
+                }
+
+                w1 = tiles->firstWord + MIN((tc + 1) * TILE_WORDS,
+                                            tiles->numWords);
+
+                for (w = tiles->firstWord + tc * TILE_WORDS; w < w1; ++w) {
+                    // Torus columns can still be wrapped into the last one
+                    cells[0] = matrix[r][w];
+                    cells[1] = lastMatrix[r][w];
+                    if (w == grid->maskWord) {
+                        cells[0] &= grid->lastMask;
+                        cells[1] &= grid->lastMask;
+                    }
+
+                    born = __builtin_popcountll(cells[0] & ~cells[1]);
+                    died = __builtin_popcountll(cells[1] & ~cells[0]);
+
+                    births    += born;
+                    deaths    += died;
+                    rowChange += born - died;
+                    live->words[w - grid->firstWord] += born - died;
+                }
+            }
+
+            live->rows[r - grid->firstRow] += rowChange;
+        }
+    }
+
+    live->births      = births;
+    live->deaths      = deaths;
+    live->population += births - deaths;
+}
+
+
+void reportStats(uint64_t** matrix, Grid* grid, LiveCount* live,
+                 MPI_Datatype statsType, MPI_Op statsOp, FILE* file,
+                 int generation) {
+
+    Stats mine;       // Stats of my block
+    Stats total;      // and of the whole matrix
+    uint64_t cells;   // Live cells down the edge words of my live cells
+    int side;
+    int r;
+    int w;
+
+    mine.population = live->population;
+    mine.births     = live->births;
+    mine.deaths     = live->deaths;
+    mine.box[0]     = INT64_MAX;
+    mine.box[1]     = -1;
+    mine.box[2]     = INT64_MAX;
+    mine.box[3]     = -1;
+
+    // The first and last rows with a live cell come straight from the counts
+    for (r = 0; r < grid->myRows; ++r) {
+        if (live->rows[r] != 0) {
+            mine.box[0] = MIN(mine.box[0], grid->rowLow + r);
+            mine.box[1] = grid->rowLow + r;
+        }
+    }
+
+    // The counts only say which words the first and last columns are in,
+    // so look down those two words for the bits
+    for (side = 0; side < 2 && mine.population != 0; ++side) {
+        w = 0;
+        if (side == 0) {
+            while (live->words[w] == 0) {
+                ++w;
+            }
+        } else {
+            w = grid->myWords - 1;
+            while (live->words[w] == 0) {
+                --w;
+            }
+        }
+
+        cells = 0;
+        for (r = grid->firstRow; r < grid->firstRow + grid->myRows; ++r) {
+            cells |= matrix[r][grid->firstWord + w];
+        }
+        if (grid->firstWord + w == grid->maskWord) {
+            cells &= grid->lastMask;
+        }
+
+        mine.box[2 + side] = (int64_t) (grid->wordLow + w) * CELLS_PER_WORD
+                           + (side == 0 ? __builtin_ctzll(cells)
+                                        : 63 - __builtin_clzll(cells));
+    }
+
+    MPI_Reduce(&mine, &total, 1, statsType, statsOp, 0, grid->comm);
+
+    if (grid->myRank == 0) {
+        fprintf(file, "%d,%lld,%lld,%lld", generation,
+                (long long) total.population, (long long) total.births,
+                (long long) total.deaths);
+
+        // An empty matrix has no bounds
+        if (total.population == 0) {
+            fprintf(file, ",,,,\n");
+        } else {
+            fprintf(file, ",%lld,%lld,%lld,%lld\n", (long long) total.box[0],
+                    (long long) total.box[1], (long long) total.box[2],
+                    (long long) total.box[3]);
+        }
+    }
+}
+
+
+void combineStats(void* in, void* inout, int* len, MPI_Datatype* type) {
+    Stats* a = (Stats*) in;
+    Stats* b = (Stats*) inout;
+    int i;
+
+    (void) type;
+
+    for (i = 0; i < *len; ++i) {
+        b[i].population += a[i].population;
+        b[i].births     += a[i].births;
+        b[i].deaths     += a[i].deaths;
+        b[i].box[0]      = MIN(a[i].box[0], b[i].box[0]);
+        b[i].box[1]      = MAX(a[i].box[1], b[i].box[1]);
+        b[i].box[2]      = MIN(a[i].box[2], b[i].box[2]);
+        b[i].box[3]      = MAX(a[i].box[3], b[i].box[3]);
+    }
+}
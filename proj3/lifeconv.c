@@ -0,0 +1,212 @@
+// Board file converter
+//******************************************************************************
+// lifeconv.c
+//
+// Summary: Converts ASCII matrix files, like the ones matrix_maker writes,
+//          to binary board files and back. The direction is picked from
+//          the input file, so converting twice gives back the original.
+//
+// Author:  agent
+// Created: Oct 2026
+//******************************************************************************
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitboard.h"
+#include "boardfile.h"
+
+
+#define OPEN_FILE_ERROR -1
+#define MALLOC_ERROR    -2
+
+
+// Writes a binary board file with the rows of an ASCII matrix file
+void asciiToBinary(FILE* in, FILE* out, int packed);
+
+
+// Writes an ASCII matrix file with the rows of a binary board file
+void binaryToAscii(FILE* in, FILE* out, BoardHeader* header);
+
+
+int main(int argc, char* argv[]) {
+
+    static struct option longOptions[] = {
+        {"unpacked", no_argument, NULL, 'u'},
+        {NULL,       0,           NULL,  0 }
+    };
+
+    FILE* in;            // File being converted
+    FILE* out;           // File being written
+    BoardHeader header;  // Header of the input, if it is binary
+    int packed;          // Write 64 cells to a word instead of a byte each
+    int binary;          // What kind of file the input is
+    int opt;
+
+    // Check command line arguments
+    packed = 1;
+
+    while ((opt = getopt_long(argc, argv, "", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'u':
+                packed = 0;
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+
+    if (argc - optind != 2) {
+        printf("\nUsage: %s [options] infile outfile\n"
+               "  An ASCII infile becomes a binary board file and a binary\n"
+               "  infile becomes an ASCII matrix file.\n"
+               "  --unpacked  write one byte per cell instead of 64 cells "
+               "per word\n", argv[0]);
+        return 1;
+    }
+
+    in = fopen(argv[optind], "rb");
+    if (in == NULL) {
+        printf("\nError: cannot open %s\n\n", argv[optind]);
+        return OPEN_FILE_ERROR;
+    }
+
+    binary = readBoardHeader(in, &header);
+    if (binary < 0) {
+        printf("\nError: %s has a bad board header\n\n", argv[optind]);
+        return OPEN_FILE_ERROR;
+    }
+
+    out = fopen(argv[optind + 1], "wb");
+    if (out == NULL) {
+        printf("\nError: cannot open %s\n\n", argv[optind + 1]);
+        return OPEN_FILE_ERROR;
+    }
+
+    if (binary) {
+        binaryToAscii(in, out, &header);
+    } else {
+        asciiToBinary(in, out, packed);
+    }
+
+    fclose(in);
+    if (fclose(out) != 0) {
+        printf("\nError: cannot write %s\n\n", argv[optind + 1]);
+        return OPEN_FILE_ERROR;
+    }
+
+    return 0;
+}
+
+
+void asciiToBinary(FILE* in, FILE* out, int packed) {
+
+    BoardHeader header;  // Header of the output
+    char* line;          // One row of LIVE/DEAD characters
+    uint64_t* words;     // The same row packed, with a guard word either side
+    int numRows;         // Dimensions of the matrix
+    int numCols;
+    int r;
+    int c;
+    char junk;           // Somewhere to toss newlines
+
+    if (fscanf(in, "%d %d", &numRows, &numCols) != 2
+        || numRows <= 0 || numCols <= 0) {
+        printf("\nError: input is not a matrix file\n\n");
+        exit(OPEN_FILE_ERROR);
+    }
+
+    line  = (char*) malloc(numCols);
+    words = (uint64_t*) malloc(ROW_WORDS(numCols) * sizeof(uint64_t));
+
+    if (line == NULL || words == NULL) {
+        exit(MALLOC_ERROR);
+    }
+
+    initBoardHeader(&header, numRows, numCols, packed);
+    fwrite(&header, sizeof(BoardHeader), 1, out);
+
+    for (r = 0; r < numRows; ++r) {
+
+        // Remove newline character, then read the row
+        if (fscanf(in, "%c", &junk) != 1
+            || fread(line, sizeof(char), numCols, in) != (size_t) numCols) {
+            printf("\nError: matrix file ends at row %d\n\n", r);
+            exit(OPEN_FILE_ERROR);
+        }
+
+        if (packed) {
+            memset(words, 0, ROW_WORDS(numCols) * sizeof(uint64_t));
+            packRow(line, words, numCols);
+            fwrite(words + 1, sizeof(uint64_t), WORDS_FOR(numCols), out);
+        } else {
+            for (c = 0; c < numCols; ++c) {
+                line[c] = (line[c] == LIVE);
+            }
+            fwrite(line, sizeof(char), numCols, out);
+        }
+    }
+
+    free(words);
+    free(line);
+}
+
+
+void binaryToAscii(FILE* in, FILE* out, BoardHeader* header) {
+
+    int64_t rowBytes;    // Bytes of cells at the start of each row
+    uint64_t* words;     // A packed row with a guard word either side, or
+                         // room for a row of bytes
+    unsigned char* row;  // The cells of a row as they are in the file
+    char* line;          // The same row as LIVE/DEAD characters
+    int r;
+    int c;
+
+    rowBytes = boardRowBytes(header->numCols, header->packed);
+    words = (uint64_t*) malloc(ROW_WORDS(header->numCols) * sizeof(uint64_t)
+                               + header->numCols);
+    line  = (char*) malloc(header->numCols + 1);
+
+    if (words == NULL || line == NULL) {
+        exit(MALLOC_ERROR);
+    }
+
+    // Packed rows are read in past the guard word so GET_CELL() works
+    row = header->packed ? (unsigned char*) (words + 1)
+                         : (unsigned char*) words;
+
+    fprintf(out, "%d %d", header->numRows, header->numCols);
+
+    if (fseek(in, header->dataStart, SEEK_SET) != 0) {
+        exit(OPEN_FILE_ERROR);
+    }
+
+    // Each row goes after a newline, the same as matrix files are read
+    line[0] = '\n';
+
+    for (r = 0; r < header->numRows; ++r) {
+        if (fread(row, 1, rowBytes, in) != (size_t) rowBytes
+            || fseek(in, header->rowStride - rowBytes, SEEK_CUR) != 0) {
+            printf("\nError: board file ends at row %d\n\n", r);
+            exit(OPEN_FILE_ERROR);
+        }
+
+        for (c = 0; c < header->numCols; ++c) {
+            if (header->packed) {
+                line[c+1] = GET_CELL(words, c) ? LIVE : DEAD;
+            } else {
+                line[c+1] = row[c] ? LIVE : DEAD;
+            }
+        }
+
+        fwrite(line, sizeof(char), header->numCols + 1, out);
+    }
+
+    fputc('\n', out);
+
+    free(line);
+    free(words);
+}
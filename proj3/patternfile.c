@@ -0,0 +1,191 @@
+// Game of Life pattern file
+//******************************************************************************
+// patternfile.c
+//
+// Summary: Reads RLE and plaintext patterns one run of live cells at a time.
+//
+// Author:  agent
+// Created: Oct 2026
+//******************************************************************************
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "patternfile.h"
+
+// Longest RLE header line we look at, the rest of it is skipped
+#define HEADER_SIZE 256
+
+
+// Reads what is left of the current line
+static void skipLine(FILE* file);
+
+
+// Reads the runs of an RLE pattern that is numRows x numCols, up to the '!'
+// at its end
+static int readRle(FILE* file, int numRows, int numCols, PatternRun run,
+                   void* data);
+
+
+// Reads the rows of a plaintext pattern, finding out how big it is on the way
+static int readCells(FILE* file, int* numRows, int* numCols, PatternRun run,
+                     void* data);
+
+
+int readPattern(FILE* file, int* numRows, int* numCols, PatternRun run,
+                void* data) {
+
+    char header[HEADER_SIZE]; // The "x = COLS, y = ROWS" line of an RLE file
+    int c;
+
+    // Both formats start with their own kind of comment lines
+    while ((c = fgetc(file)) == '#' || c == '!') {
+        skipLine(file);
+    }
+
+    if (c != 'x') {
+        if (c != EOF) {
+            ungetc(c, file);
+        }
+        return readCells(file, numRows, numCols, run, data);
+    }
+
+    if (fgets(header, sizeof(header), file) == NULL
+        || sscanf(header, " = %d , y = %d", numCols, numRows) != 2
+        || *numRows <= 0 || *numCols <= 0) {
+        return -1;
+    }
+    if (strchr(header, '\n') == NULL) {
+        skipLine(file);
+    }
+
+    return readRle(file, *numRows, *numCols, run, data);
+}
+
+
+static void skipLine(FILE* file) {
+    int c;
+
+    do {
+        c = fgetc(file);
+    } while (c != '\n' && c != EOF);
+}
+
+
+static int readRle(FILE* file, int numRows, int numCols, PatternRun run,
+                   void* data) {
+
+    int row;    // Where the next run starts
+    int col;
+    int count;  // Run count read so far, 0 if there is none
+    int length; // Cells in the run, 1 without a count
+    int c;
+
+    row   = 0;
+    col   = 0;
+    count = 0;
+    while ((c = fgetc(file)) != EOF && c != '!') {
+        if (isdigit(c)) {
+            if (count > (INT_MAX - 9) / 10) {
+                return -1;
+            }
+            count = count * 10 + (c - '0');
+            continue;
+        }
+
+        if (isspace(c)) {
+            continue;
+        }
+
+        length = count > 0 ? count : 1;
+        count  = 0;
+
+        if (c == '$') {
+            // Runs of empty rows end with a count too
+            row += length;
+            col  = 0;
+
+        } else if (c == 'b' || c == '.') {
+            col += length;
+
+        } else if (isalpha(c)) {
+            // Patterns with more states than two call live cells by other
+            // letters, which are all alive here
+            if (row >= numRows || length > numCols - col) {
+                return -1;
+            }
+            if (run != NULL) {
+                run(row, col, length, data);
+            }
+            col += length;
+
+        } else {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+static int readCells(FILE* file, int* numRows, int* numCols, PatternRun run,
+                     void* data) {
+
+    int row;    // Where the next cell is
+    int col;
+    int first;  // Column the current run of live cells started at, or -1
+    int c;
+
+    *numRows = 0;
+    *numCols = 0;
+
+    row   = 0;
+    col   = 0;
+    first = -1;
+    do {
+        c = fgetc(file);
+
+        if (c == 'O' || c == '*') {
+            if (first < 0) {
+                first = col;
+            }
+            ++col;
+            continue;
+        }
+
+        // Anything else ends the run
+        if (first >= 0) {
+            if (run != NULL) {
+                run(row, first, col - first, data);
+            }
+            first = -1;
+        }
+
+        if (c == '.') {
+            ++col;
+
+        } else if (c == '!' && col == 0) {
+            skipLine(file);
+
+        } else if (c == '\n' || (c == EOF && col > 0)) {
+            // Rows can leave off the dead cells at their end
+            if (col > *numCols) {
+                *numCols = col;
+            }
+            ++row;
+            col = 0;
+
+        } else if (c != '\r' && c != EOF) {
+            return -1;
+        }
+    } while (c != EOF);
+
+    *numRows = row;
+    if (*numRows == 0 || *numCols == 0) {
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,34 @@
+// Game of Life pattern file
+//******************************************************************************
+// patternfile.h
+//
+// Summary: Reads the pattern formats Life programs share, run length encoded
+//          (.rle) and plaintext (.cells), without ever holding the board the
+//          pattern goes in. Live cells come out a run at a time, so reading
+//          takes as long as the pattern is big and no longer.
+//
+// Author:  agent
+// Created: Oct 2026
+//******************************************************************************
+
+#ifndef PATTERNFILE_H
+#define PATTERNFILE_H
+
+#include <stdio.h>
+
+
+// Called for every run of length live cells starting at row and col of the
+// pattern, from the top row down
+typedef void (*PatternRun)(int row, int col, int length, void* data);
+
+
+// Reads an RLE or plaintext pattern and sets numRows and numCols to its
+// size. RLE files start with an "x = COLS, y = ROWS" line after any '#'
+// comments, and plaintext files are rows of '.' and 'O' after any '!'
+// comments. Each run of live cells is handed to run with data, unless run is
+// NULL. Returns 0, or -1 if the file is not a pattern or has cells outside of
+// the size it gives.
+int readPattern(FILE* file, int* numRows, int* numCols, PatternRun run,
+                void* data);
+
+#endif
@@ -0,0 +1,2 @@
+# One process per host, each with a team of threads for its cores
+mpiexec -f hosts -ppn 1 -n 3 -genv OMP_NUM_THREADS 4 a.out $1 $2 $3
@@ -0,0 +1,883 @@
+// Threaded Game of Life
+//******************************************************************************
+// threadlife.c
+//
+// Summary: Game of Life on one node without MPI. A pool of threads steps
+//          the board a tile at a time. Each thread keeps the tiles it has to
+//          step in a deque of its own and steals from the others when it
+//          runs out. There is no barrier between generations: a tile moves
+//          on as soon as the tiles around it have caught up, so fast parts
+//          of the board can run a generation ahead of slow ones. Reads and
+//          writes the same matrix files as life.c.
+//
+// Author:  agent
+// Created: Oct 2026
+//******************************************************************************
+
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bitboard.h"
+#include "boardfile.h"
+
+
+#define OPEN_FILE_ERROR -1
+#define MALLOC_ERROR    -2
+
+
+// How snapshots are written, when they go to files
+#define SNAPSHOT_ASCII  0   // The same format as matrix files
+#define SNAPSHOT_BINARY 1   // Packed binary board files
+
+
+// Tiles are big enough that handing one out costs little next to stepping
+// it, and small enough that every thread gets plenty
+#define DEFAULT_TILE_ROWS  64
+#define DEFAULT_TILE_WORDS 4
+
+
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+
+
+// Tiles waiting to be stepped by one thread. The thread pushes and pops at
+// the bottom, and threads with nothing to do steal from the top, the
+// deque of Chase and Lev. A tile is in at most one deque at a time, so the
+// ring never needs more room than there are tiles.
+struct deque {
+    _Atomic long top;      // Next tile to be stolen
+    _Atomic long bottom;   // Where the next tile is pushed
+    _Atomic int* tiles;    // Ring of mask + 1 tiles
+    long mask;
+};
+typedef struct deque Deque;
+
+
+// The board and everything the threads share while stepping it. Generation
+// g of a tile is in boards[g % 2], and it can only be written over once
+// every tile around it has used it to get to generation g + 1.
+struct engine {
+    uint64_t** boards[2];  // Two boards with dead halo rows and guard words
+    int numRows;           // Dimensions of the matrix
+    int numCols;
+    int numWords;          // Words of cells in each row
+    uint64_t lastMask;     // Real cells in the last word of a row
+
+    int tileRows;          // Rows and words in each tile
+    int tileWords;
+    int tilesDown;         // Tiles down and across the board
+    int tilesAcross;
+    int numTiles;
+
+    _Atomic int* generation;    // Generation each tile has got to
+    _Atomic char* queued;       // Tile is in a deque or being stepped
+    unsigned char* changed[2];  // Generation g of each tile is different
+                                // from g - 1, in changed[g % 2]
+
+    int target;                 // Generation every tile stops at
+    _Atomic long remaining;     // Tile steps left until they all get there
+
+    int numThreads;
+    Deque* deques;              // One for each thread
+};
+typedef struct engine Engine;
+
+
+// What each thread is given to start with
+struct worker {
+    Engine* engine;
+    int id;                // Which deque is mine
+    unsigned int seed;     // For picking who to steal from
+};
+typedef struct worker Worker;
+
+
+// Seconds since some fixed point, for timing
+double now(void);
+
+
+// Reads a matrix file or binary board file into a board with a dead halo
+// row above and below, and finds the generation it was saved at
+uint64_t** readMatrix(char* filename, int* numRows, int* numCols,
+                      int* generation);
+
+
+// Prints the matrix in the same format as printSubmatrix() in life.c
+void printMatrix(uint64_t** board, int numRows, int numCols);
+
+
+// Writes the matrix to a file in the same format as life.c snapshots
+void writeMatrix(uint64_t** board, int numRows, int numCols, char* filename,
+                 int format, int generation);
+
+
+// Prints the matrix after some generation, or writes it to that
+// generation's snapshot file
+void outputMatrix(uint64_t** board, int numRows, int numCols, char* snapshot,
+                  int format, int generation);
+
+
+// Splits the board into tiles for numThreads threads, every tile at
+// generation start. Takes over board. Returns -1 if memory ran out.
+int createEngine(Engine* engine, uint64_t** board, int numRows, int numCols,
+                 int tileRows, int tileWords, int numThreads, int start);
+
+
+void freeEngine(Engine* engine);
+
+
+// Steps every tile from generation from to generation to, and returns the
+// board they are all at then
+uint64_t** runEngine(Engine* engine, int from, int to);
+
+
+// Steps tiles until there are none left to step
+void* work(void* arg);
+
+
+// Steps a tile to its next generation. Tiles where nothing around them
+// changed in the last generation are already right in the board they go to.
+void stepTile(Engine* engine, int tile);
+
+
+// Checks if a tile can be stepped: it has not reached the target, and every
+// tile around it has reached its generation
+int isReady(Engine* engine, int tile);
+
+
+// Pushes a tile onto deque if it is ready and nobody else has it
+void wakeTile(Engine* engine, Deque* deque, int tile);
+
+
+void pushTile(Deque* deque, int tile);
+
+
+// Takes the tile pushed last, or returns -1 if there are none
+int popTile(Deque* deque);
+
+
+// Takes the tile pushed first, or returns -1 if there are none or another
+// thread got there first
+int stealTile(Deque* deque);
+
+
+int main(int argc, char* argv[]) {
+
+    static struct option longOptions[] = {
+        {"threads",         required_argument, NULL, 'n'},
+        {"tile",            required_argument, NULL, 'T'},
+        {"snapshot",        required_argument, NULL, 'o'},
+        {"snapshot-format", required_argument, NULL, 'f'},
+        {"rule",            required_argument, NULL, 'L'},
+        {NULL,              0,                 NULL,  0 }
+    };
+
+    double startTime; // Seconds at start of the program
+    double readTime;  // Seconds at end of reading matrix from file
+    double stepTime;  // Seconds at end of loop
+    double endTime;   // Seconds at end of program
+
+    int numIterations;  // How many generations to run
+    int printMod;       // How frequently to print out the matrix
+    int numThreads;     // Threads stepping tiles
+    int tileRows;       // Size of each tile
+    int tileWords;
+    char* snapshot;     // Write snapshots to files starting with this
+    int format;         // instead of printing them, in this format
+    LifeRule rule;      // Neighbor counts that cells are born and survive
+
+    int numRows;        // Dimensions of the matrix
+    int numCols;
+    int start;          // Generation the run starts from
+    int done;           // Generation every tile has reached
+    int next;           // Generation to stop at next
+    int opt;
+
+    Engine engine;      // The tiles and the threads stepping them
+    uint64_t** board;   // Where the current generation is
+
+    // Check command line arguments
+    numThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    tileRows   = DEFAULT_TILE_ROWS;
+    tileWords  = DEFAULT_TILE_WORDS;
+    snapshot   = NULL;
+    format     = SNAPSHOT_ASCII;
+    parseRule("B3/S23", &rule);
+
+    while ((opt = getopt_long(argc, argv, "", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                numThreads = atoi(optarg);
+                if (numThreads <= 0) {
+                    printf("\nError: threads must be a positive integer\n\n");
+                    return 5;
+                }
+                break;
+            case 'T':
+                if (sscanf(optarg, "%dx%d", &tileRows, &tileWords) != 2
+                    || tileRows <= 0 || tileWords <= 0) {
+                    printf("\nError: tile must be ROWSxWORDS\n\n");
+                    return 6;
+                }
+                break;
+            case 'o':
+                snapshot = optarg;
+                break;
+            case 'f':
+                if (strcmp(optarg, "ascii") == 0) {
+                    format = SNAPSHOT_ASCII;
+                } else if (strcmp(optarg, "binary") == 0) {
+                    format = SNAPSHOT_BINARY;
+                } else {
+                    printf("\nError: snapshot format must be ascii or "
+                           "binary\n\n");
+                    return 7;
+                }
+                break;
+            case 'L':
+                if (parseRule(optarg, &rule) != 0) {
+                    printf("\nError: rule must be like B3/S23, with counts "
+                           "from 0 to 8\n\n");
+                    return 10;
+                }
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+
+    if (argc - optind != 3) {
+        printf("\nUsage: %s [options] filename iterations printFrequency\n"
+               "  --threads N            threads stepping tiles, one per "
+               "core by default\n"
+               "  --tile ROWSxWORDS      size of the tiles handed to "
+               "threads, %dx%d by default\n"
+               "  --snapshot PREFIX      write the matrix to PREFIX.GEN "
+               "instead of printing it\n"
+               "  --snapshot-format F    ascii, like the input, or binary\n"
+               "  --rule Bxx/Syy         counts that cells are born and "
+               "survive with, B3/S23\n"
+               "                         by default\n",
+               argv[0], DEFAULT_TILE_ROWS, DEFAULT_TILE_WORDS);
+        return 1;
+    }
+
+    numIterations = atoi(argv[optind + 1]);
+    if (numIterations <= 0) {
+        printf("\nError: number of iterations must be a positive integer");
+        return 3;
+    }
+
+    printMod = atoi(argv[optind + 2]);
+    if (printMod < 0) {
+        printf("\nError: print frequency cannot be negative\n\n");
+        return 4;
+    }
+
+    setRule(&rule);
+
+    startTime = now();
+
+
+    // Read the matrix in and print it once before modifying it
+    board = readMatrix(argv[optind], &numRows, &numCols, &start);
+
+    if (createEngine(&engine, board, numRows, numCols, tileRows, tileWords,
+                     numThreads, start) != 0) {
+        exit(MALLOC_ERROR);
+    }
+
+    outputMatrix(board, numRows, numCols, snapshot, format, start);
+
+    readTime = now();
+
+
+    // Tiles only have to line up again when the matrix is printed
+    for (done = start; done < numIterations; done = next) {
+        next = numIterations;
+        if (printMod != 0) {
+            next = MIN(next, (done / printMod + 1) * printMod);
+        }
+
+        board = runEngine(&engine, done, next);
+
+        if (printMod != 0 && next % printMod == 0) {
+            outputMatrix(board, numRows, numCols, snapshot, format, next);
+        }
+    }
+
+    stepTime = now();
+
+    // Print out the resulting matrix
+    board = engine.boards[done % 2];
+    outputMatrix(board, numRows, numCols, snapshot, format, numIterations);
+
+
+    // Print runtimes to stderr so stdout can be piped to /dev/null. The
+    // first one is how many threads there were.
+    endTime = now();
+    fprintf(stderr, "%d,%d,%d,%d,%d,%.15f,%.15f,%.15f\n", numThreads,
+                    numRows, numCols, printMod, numIterations,
+                    readTime-startTime, stepTime-startTime,
+                    endTime-startTime);
+
+    freeEngine(&engine);
+    return 0;
+}
+
+
+
+
+double now(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+
+uint64_t** readMatrix(char* filename, int* numRows, int* numCols,
+                      int* generation) {
+
+    FILE* matrixFile;   // File pointer for matrix file
+    BoardHeader header; // Header of a binary board file
+    int binary;         // Which kind of file it is
+    int64_t rowBytes;   // Bytes of cells at the start of each row
+    char* line;         // One row as it is in the file
+    uint64_t** board;
+    char junk;          // Somewhere to toss newlines
+    int r;
+    int c;
+
+    matrixFile = fopen(filename, "rb");
+    if (matrixFile == NULL) {
+        exit(OPEN_FILE_ERROR);
+    }
+
+    binary = readBoardHeader(matrixFile, &header);
+
+    if (binary > 0) {
+        *numRows    = header.numRows;
+        *numCols    = header.numCols;
+        *generation = header.generation;
+    } else if (binary < 0
+               || fscanf(matrixFile, "%d %d", numRows, numCols) != 2
+               || *numRows <= 0 || *numCols <= 0) {
+        exit(OPEN_FILE_ERROR);
+    } else {
+        *generation = 0;
+    }
+
+    board = allocBoard(*numRows + 2, ROW_WORDS(*numCols));
+    line  = (char*) malloc(*numCols);
+
+    if (board == NULL || line == NULL) {
+        exit(MALLOC_ERROR);
+    }
+
+    if (binary) {
+        rowBytes = boardRowBytes(*numCols, header.packed);
+
+        for (r = 0; r < *numRows; ++r) {
+            if (fseek(matrixFile, header.dataStart + r * header.rowStride,
+                      SEEK_SET) != 0) {
+                exit(OPEN_FILE_ERROR);
+            }
+
+            // Packed rows go straight in past the guard word
+            if (header.packed) {
+                if (fread(board[r + 1] + 1, 1, rowBytes, matrixFile)
+                    != (size_t) rowBytes) {
+                    exit(OPEN_FILE_ERROR);
+                }
+                board[r + 1][WORDS_FOR(*numCols)] &= lastWordMask(*numCols);
+                continue;
+            }
+
+            if (fread(line, 1, rowBytes, matrixFile) != (size_t) rowBytes) {
+                exit(OPEN_FILE_ERROR);
+            }
+            for (c = 0; c < *numCols; ++c) {
+                if (line[c]) {
+                    SET_CELL(board[r + 1], c);
+                }
+            }
+        }
+
+    } else {
+        // Read in rows, each after a newline
+        for (r = 0; r < *numRows; ++r) {
+            if (fscanf(matrixFile, "%c", &junk) != 1
+                || fread(line, sizeof(char), *numCols, matrixFile)
+                   != (size_t) *numCols) {
+                exit(OPEN_FILE_ERROR);
+            }
+            packRow(line, board[r + 1], *numCols);
+        }
+    }
+
+    fclose(matrixFile);
+    free(line);
+
+    return board;
+}
+
+
+void printMatrix(uint64_t** board, int numRows, int numCols) {
+    char* line;   // One row of '+' and ' ', ending in a newline
+    int r;
+    int c;
+
+    line = (char*) malloc(numCols + 1);
+    if (line == NULL) {
+        exit(MALLOC_ERROR);
+    }
+
+    line[numCols] = '\n';
+
+    for (r = 1; r <= numRows; ++r) {
+        for (c = 0; c < numCols; ++c) {
+            line[c] = GET_CELL(board[r], c) ? '+' : ' ';
+        }
+        fwrite(line, sizeof(char), numCols + 1, stdout);
+    }
+
+    free(line);
+}
+
+
+void writeMatrix(uint64_t** board, int numRows, int numCols, char* filename,
+                 int format, int generation) {
+
+    FILE* snapFile;      // File the matrix is written to
+    BoardHeader header;  // Header of a binary file
+    char* line;          // One row as LIVE/DEAD characters and a newline
+    int r;
+    int c;
+
+    snapFile = fopen(filename, "wb");
+    line     = (char*) malloc(numCols + 1);
+
+    if (snapFile == NULL) {
+        exit(OPEN_FILE_ERROR);
+    }
+    if (line == NULL) {
+        exit(MALLOC_ERROR);
+    }
+
+    if (format == SNAPSHOT_BINARY) {
+        initBoardHeader(&header, numRows, numCols, 1);
+        header.generation = generation;
+        fwrite(&header, sizeof(BoardHeader), 1, snapFile);
+
+        for (r = 1; r <= numRows; ++r) {
+            fwrite(board[r] + 1, sizeof(uint64_t), WORDS_FOR(numCols),
+                   snapFile);
+        }
+
+    } else {
+        // Each row ends in a newline, the header's row too
+        fprintf(snapFile, "%d %d\n", numRows, numCols);
+        line[numCols] = '\n';
+
+        for (r = 1; r <= numRows; ++r) {
+            for (c = 0; c < numCols; ++c) {
+                line[c] = GET_CELL(board[r], c) ? LIVE : DEAD;
+            }
+            fwrite(line, sizeof(char), numCols + 1, snapFile);
+        }
+    }
+
+    free(line);
+    if (fclose(snapFile) != 0) {
+        exit(OPEN_FILE_ERROR);
+    }
+}
+
+
+void outputMatrix(uint64_t** board, int numRows, int numCols, char* snapshot,
+                  int format, int generation) {
+
+    static int printed = 0;      // Matrices printed so far by this run
+    char filename[FILENAME_MAX]; // Snapshot file for this generation
+
+    if (snapshot != NULL) {
+        snprintf(filename, sizeof(filename), "%s.%d", snapshot, generation);
+        writeMatrix(board, numRows, numCols, filename, format, generation);
+        return;
+    }
+
+    // Printed matrices after the first are set apart by blank lines, even
+    // when the board starts past generation 0
+    if (printed++ > 0) {
+        printf("\n\n");
+    }
+    printMatrix(board, numRows, numCols);
+}
+
+
+int createEngine(Engine* engine, uint64_t** board, int numRows, int numCols,
+                 int tileRows, int tileWords, int numThreads, int start) {
+
+    long size;   // Room in each deque
+    int t;
+
+    engine->numRows   = numRows;
+    engine->numCols   = numCols;
+    engine->numWords  = WORDS_FOR(numCols);
+    engine->lastMask  = lastWordMask(numCols);
+
+    engine->tileRows    = MIN(tileRows, numRows);
+    engine->tileWords   = MIN(tileWords, engine->numWords);
+    engine->tilesDown   = (numRows + engine->tileRows - 1) / engine->tileRows;
+    engine->tilesAcross = (engine->numWords + engine->tileWords - 1)
+                        / engine->tileWords;
+    engine->numTiles    = engine->tilesDown * engine->tilesAcross;
+    engine->numThreads  = numThreads;
+
+    engine->boards[start % 2]       = board;
+    engine->boards[(start + 1) % 2] = allocBoard(numRows + 2,
+                                                 ROW_WORDS(numCols));
+
+    engine->generation = malloc(engine->numTiles * sizeof(_Atomic int));
+    engine->queued     = malloc(engine->numTiles * sizeof(_Atomic char));
+    engine->changed[0] = malloc(engine->numTiles);
+    engine->changed[1] = malloc(engine->numTiles);
+    engine->deques     = malloc(numThreads * sizeof(Deque));
+
+    if (engine->boards[(start + 1) % 2] == NULL || engine->generation == NULL
+        || engine->queued == NULL || engine->changed[0] == NULL
+        || engine->changed[1] == NULL || engine->deques == NULL) {
+        return -1;
+    }
+
+    // Every tile has to be stepped the first time
+    for (t = 0; t < engine->numTiles; ++t) {
+        atomic_init(&engine->generation[t], start);
+        atomic_init(&engine->queued[t], 0);
+    }
+    memset(engine->changed[start % 2], 1, engine->numTiles);
+
+    for (size = 1; size < engine->numTiles; size *= 2) {
+    }
+
+    for (t = 0; t < numThreads; ++t) {
+        atomic_init(&engine->deques[t].top, 0);
+        atomic_init(&engine->deques[t].bottom, 0);
+        engine->deques[t].mask  = size - 1;
+        engine->deques[t].tiles = malloc(size * sizeof(_Atomic int));
+
+        if (engine->deques[t].tiles == NULL) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+void freeEngine(Engine* engine) {
+    int t;
+
+    for (t = 0; t < engine->numThreads; ++t) {
+        free(engine->deques[t].tiles);
+    }
+    free(engine->deques);
+    free(engine->changed[0]);
+    free(engine->changed[1]);
+    free((void*) engine->queued);
+    free((void*) engine->generation);
+    freeBoard(engine->boards[0]);
+    freeBoard(engine->boards[1]);
+}
+
+
+uint64_t** runEngine(Engine* engine, int from, int to) {
+
+    pthread_t* threads;  // Everyone stepping tiles but me
+    Worker* workers;     // What each of us starts with
+    int t;
+
+    threads = (pthread_t*) malloc(engine->numThreads * sizeof(pthread_t));
+    workers = (Worker*) malloc(engine->numThreads * sizeof(Worker));
+
+    if (threads == NULL || workers == NULL) {
+        exit(MALLOC_ERROR);
+    }
+
+    engine->target = to;
+    atomic_store(&engine->remaining, (long) engine->numTiles * (to - from));
+
+    // Every tile is ready to start. Each thread starts with a band of rows
+    // of tiles, so what it steals is all that moves between caches.
+    for (t = 0; t < engine->numTiles; ++t) {
+        atomic_store(&engine->queued[t], 1);
+        pushTile(&engine->deques[(long) (t / engine->tilesAcross)
+                                 * engine->numThreads / engine->tilesDown],
+                 t);
+    }
+
+    // Pick the kernel before any threads start, so they don't race to
+    stepRegion(engine->boards[0], engine->boards[1], 1, 0, 1, 0, 0, 0);
+
+    for (t = 0; t < engine->numThreads; ++t) {
+        workers[t].engine = engine;
+        workers[t].id     = t;
+        workers[t].seed   = t + 1;
+
+        if (t > 0 && pthread_create(&threads[t], NULL, work,
+                                    &workers[t]) != 0) {
+            exit(MALLOC_ERROR);
+        }
+    }
+
+    work(&workers[0]);
+
+    for (t = 1; t < engine->numThreads; ++t) {
+        pthread_join(threads[t], NULL);
+    }
+
+    free(workers);
+    free(threads);
+
+    return engine->boards[to % 2];
+}
+
+
+void* work(void* arg) {
+
+    Worker* me = (Worker*) arg;
+    Engine* engine = me->engine;
+    Deque* mine = &engine->deques[me->id];
+    int tile;
+    int victim;     // Thread whose deque is being stolen from
+    int i;
+    int dr;
+    int dc;
+    int r;
+    int c;
+
+    while (atomic_load(&engine->remaining) > 0) {
+        tile = popTile(mine);
+
+        // Out of work, so take the oldest tile of someone else's
+        for (i = 1; tile < 0 && i < engine->numThreads; ++i) {
+            victim = (me->id + i + rand_r(&me->seed)) % engine->numThreads;
+            if (victim != me->id) {
+                tile = stealTile(&engine->deques[victim]);
+            }
+        }
+
+        if (tile < 0) {
+            sched_yield();
+            continue;
+        }
+
+        stepTile(engine, tile);
+        atomic_store(&engine->queued[tile], 0);
+        atomic_fetch_sub(&engine->remaining, 1);
+
+        // The tiles around this one may have been waiting on it
+        r = tile / engine->tilesAcross;
+        c = tile % engine->tilesAcross;
+
+        for (dr = -1; dr <= 1; ++dr) {
+            for (dc = -1; dc <= 1; ++dc) {
+                if (r + dr >= 0 && r + dr < engine->tilesDown
+                    && c + dc >= 0 && c + dc < engine->tilesAcross) {
+                    wakeTile(engine, mine,
+                             (r + dr) * engine->tilesAcross + c + dc);
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+
+void stepTile(Engine* engine, int tile) {
+
+    uint64_t** from;  // Board my generation is in
+    uint64_t** to;    // Board the next one goes in
+    int g;            // My generation
+    int active;       // Something around me changed in generation g
+    int changed;      // Stepping changed me
+    int rows[2];      // First and last row and word of the tile
+    int words[2];
+    int dr;
+    int dc;
+    int r;
+    int c;
+
+    g    = atomic_load_explicit(&engine->generation[tile],
+                                memory_order_relaxed);
+    from = engine->boards[g % 2];
+    to   = engine->boards[(g + 1) % 2];
+
+    r = tile / engine->tilesAcross;
+    c = tile % engine->tilesAcross;
+
+    rows[0]  = 1 + r * engine->tileRows;
+    rows[1]  = MIN(rows[0] + engine->tileRows - 1, engine->numRows);
+    words[0] = 1 + c * engine->tileWords;
+    words[1] = MIN(words[0] + engine->tileWords - 1, engine->numWords);
+
+    active = 0;
+    for (dr = -1; dr <= 1; ++dr) {
+        for (dc = -1; dc <= 1; ++dc) {
+            if (r + dr >= 0 && r + dr < engine->tilesDown
+                && c + dc >= 0 && c + dc < engine->tilesAcross) {
+                active |= engine->changed[g % 2][(r + dr)
+                                                 * engine->tilesAcross
+                                                 + c + dc];
+            }
+        }
+    }
+
+    // Generation g - 1 of the tile is still in to, and it is the same as g
+    changed = 0;
+    if (active) {
+        stepRegion(from, to, rows[0], rows[1], words[0], words[1],
+                   engine->numWords, engine->lastMask);
+
+        for (r = rows[0]; r <= rows[1] && !changed; ++r) {
+            changed = memcmp(to[r] + words[0], from[r] + words[0],
+                             (words[1] - words[0] + 1) * sizeof(uint64_t))
+                      != 0;
+        }
+    }
+
+    engine->changed[(g + 1) % 2][tile] = changed;
+    atomic_store(&engine->generation[tile], g + 1);
+}
+
+
+int isReady(Engine* engine, int tile) {
+    int g;
+    int r;
+    int c;
+    int dr;
+    int dc;
+
+    g = atomic_load(&engine->generation[tile]);
+    if (g >= engine->target) {
+        return 0;
+    }
+
+    r = tile / engine->tilesAcross;
+    c = tile % engine->tilesAcross;
+
+    for (dr = -1; dr <= 1; ++dr) {
+        for (dc = -1; dc <= 1; ++dc) {
+            if (r + dr >= 0 && r + dr < engine->tilesDown
+                && c + dc >= 0 && c + dc < engine->tilesAcross
+                && atomic_load(&engine->generation[(r + dr)
+                                                   * engine->tilesAcross
+                                                   + c + dc]) < g) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+
+void wakeTile(Engine* engine, Deque* deque, int tile) {
+    char expected;
+
+    // A neighbor that catches up after the check sees the tile free and
+    // tries again itself, so checking once more after letting go is enough
+    while (isReady(engine, tile)) {
+        expected = 0;
+        if (!atomic_compare_exchange_strong(&engine->queued[tile], &expected,
+                                            1)) {
+            return;
+        }
+
+        // It may have been stepped between the check and taking it
+        if (isReady(engine, tile)) {
+            pushTile(deque, tile);
+            return;
+        }
+
+        atomic_store(&engine->queued[tile], 0);
+    }
+}
+
+
+void pushTile(Deque* deque, int tile) {
+    long b;
+
+    b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    atomic_store_explicit(&deque->tiles[b & deque->mask], tile,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+}
+
+
+int popTile(Deque* deque) {
+    long b;
+    long t;
+    int tile;
+
+    b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        return -1;
+    }
+
+    tile = atomic_load_explicit(&deque->tiles[b & deque->mask],
+                                memory_order_relaxed);
+
+    // The last tile may be getting stolen at the same time
+    if (t == b) {
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+                                                     memory_order_seq_cst,
+                                                     memory_order_relaxed)) {
+            tile = -1;
+        }
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    }
+
+    return tile;
+}
+
+
+int stealTile(Deque* deque) {
+    long t;
+    long b;
+    int tile;
+
+    t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (t >= b) {
+        return -1;
+    }
+
+    tile = atomic_load_explicit(&deque->tiles[t & deque->mask],
+                                memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+                                                 memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return -1;
+    }
+
+    return tile;
+}